@@ -34,6 +34,10 @@ void setup() {
       strcat(dir_path,entry->d_name);
       Serial.print(dir_path);
       Serial.print(": ");
+      if (entry->d_type == DT_DIR) {
+        Serial.println("<DIR>");
+        continue;
+      }
       FILE *fp = fopen(dir_path, "rb");
       char buffer[1024];
       int len = fread(buffer, 1, 1024, fp);
@@ -0,0 +1,153 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "Collections/ObjectPool.h"
+#include "Collections/Vector.h"
+
+namespace file_systems {
+
+/**
+ * @brief Fixed size block of memory which is managed by a ChunkedBuffer
+ * @tparam N size in bytes
+ */
+template <size_t N>
+struct Chunk {
+    uint8_t data[N];
+};
+
+/**
+ * @brief Growable byte buffer which stores the data in fixed size chunks
+ * which are taken from a shared ObjectPool. Growing the buffer never moves
+ * the existing data: we just add new chunks.
+ * The buffer can be defined on top of read only base data (copy on write):
+ * unmodified chunks are provided from the base and only the chunks which are
+ * written to are copied to RAM.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam N chunk size in bytes
+ */
+template <size_t N>
+class ChunkedBuffer {
+    public:
+        ChunkedBuffer(ObjectPool<Chunk<N>>& pool) : p_pool(&pool) {}
+        ChunkedBuffer(const ChunkedBuffer&) = delete;
+        ChunkedBuffer& operator=(const ChunkedBuffer&) = delete;
+
+        ~ChunkedBuffer() {
+            truncate(0);
+        }
+
+        /// Defines the read only data which is used for all chunks which
+        /// have not been written to: only possible as long as it is empty
+        bool setBase(const uint8_t* data, size_t size) {
+            if (len > 0) return false;
+            p_base = data;
+            base_len = size;
+            len = size;
+            // nullptr chunks are provided from the base
+            while ((size_t)chunks.size() * N < size) {
+                chunks.push_back(nullptr);
+            }
+            return true;
+        }
+
+        /// Number of valid bytes
+        size_t size() {
+            return len;
+        }
+
+        /// Number of chunks which have been allocated
+        size_t chunkCount() {
+            size_t result = 0;
+            for (int j = 0; j < chunks.size(); j++) {
+                if (chunks[j] != nullptr) result++;
+            }
+            return result;
+        }
+
+        /// Writes the data at the indicated position: a gap to the actual end
+        /// is filled with 0. Returns the number of bytes that were written
+        /// which is less then len if no chunk is available any more.
+        size_t write(size_t pos, const void* data, size_t size) {
+            const uint8_t* p_src = (const uint8_t*)data;
+            // fill the gap
+            for (size_t j = len / N; pos > len && j <= (pos - 1) / N; j++) {
+                if (chunk(j) == nullptr) return 0;
+            }
+            size_t result = 0;
+            while (result < size) {
+                size_t offset = (pos + result) % N;
+                Chunk<N>* p_chunk = chunk((pos + result) / N);
+                if (p_chunk == nullptr) break;
+                size_t n = N - offset;
+                if (n > size - result) n = size - result;
+                memcpy(p_chunk->data + offset, p_src + result, n);
+                result += n;
+            }
+            if (pos + result > len) {
+                len = pos + result;
+            }
+            return result;
+        }
+
+        /// Provides a pointer to the data at the indicated position: the
+        /// result is limited to the end of the chunk
+        size_t view(size_t pos, size_t max, const uint8_t** p_data) {
+            if (pos >= len) return 0;
+            size_t offset = pos % N;
+            size_t n = N - offset;
+            if (n > len - pos) n = len - pos;
+            if (n > max) n = max;
+            Chunk<N>* p_chunk = chunks[pos / N];
+            *p_data = p_chunk != nullptr ? p_chunk->data + offset : p_base + pos;
+            return n;
+        }
+
+        /// Reduces the size and gives the unused chunks back to the pool
+        void truncate(size_t newSize) {
+            if (newSize >= len) return;
+            size_t needed = (newSize + N - 1) / N;
+            while ((size_t)chunks.size() > needed) {
+                p_pool->release(chunks.back());
+                chunks.pop_back();
+            }
+            // a later gap must not reveal the old data
+            if (newSize % N != 0 && chunks.back() != nullptr) {
+                memset(chunks.back()->data + newSize % N, 0, N - newSize % N);
+            }
+            if (base_len > newSize) {
+                base_len = newSize;
+            }
+            len = newSize;
+        }
+
+    protected:
+        ObjectPool<Chunk<N>>* p_pool = nullptr;
+        Vector<Chunk<N>*, 4> chunks;
+        size_t len = 0;
+        const uint8_t* p_base = nullptr;
+        size_t base_len = 0;
+
+        // Provides the writable chunk at the indicated index: new chunks are
+        // zero initialized by the pool and filled with the base data
+        Chunk<N>* chunk(size_t idx) {
+            while ((size_t)chunks.size() <= idx) {
+                chunks.push_back(nullptr);
+            }
+            Chunk<N>* p_chunk = chunks[idx];
+            if (p_chunk == nullptr) {
+                p_chunk = p_pool->create();
+                if (p_chunk == nullptr) return nullptr;
+                size_t start = idx * N;
+                if (start < base_len) {
+                    size_t n = base_len - start < N ? base_len - start : N;
+                    memcpy(p_chunk->data, p_base + start, n);
+                }
+                chunks[idx] = p_chunk;
+            }
+            return p_chunk;
+        }
+};
+
+}
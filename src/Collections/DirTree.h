@@ -0,0 +1,168 @@
+#pragma once
+#include <stdlib.h>
+#include <string.h>
+#include "Collections/HashIndex.h"
+#include "Collections/PathView.h"
+
+namespace file_systems {
+
+/**
+ * @brief Node of a DirTree: a file if value is not nullptr, otherwise a
+ * directory
+ * @tparam T
+ */
+template <class T>
+struct DirNode {
+    /// full path w/o leading /
+    const char* name = nullptr;
+    /// last path component (points into name)
+    const char* base_name = nullptr;
+    T* value = nullptr;
+    DirNode* parent = nullptr;
+    DirNode* first_child = nullptr;
+    DirNode* last_child = nullptr;
+    DirNode* next_sibling = nullptr;
+    /// true if the name was allocated by the tree
+    bool name_owned = false;
+    bool isDir() { return value == nullptr; }
+};
+
+/**
+ * @brief Directory tree of files which are identified by their path (w/o
+ * leading /): the directories are created automatically when a file is
+ * added. Every node can be found with one lookup by its full path and the
+ * children of a directory are linked in the order they were added.
+ * The file names are not copied: they must stay valid as long as the file is
+ * in the tree!
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ */
+template <class T>
+class DirTree {
+    public:
+        DirTree() {
+            root_node.name = "";
+            root_node.base_name = "";
+        }
+        DirTree(const DirTree&) = delete;
+        DirTree& operator=(const DirTree&) = delete;
+
+        ~DirTree() {
+            clear(&root_node);
+        }
+
+        /// The root directory
+        DirNode<T>* root() {
+            return &root_node;
+        }
+
+        /// Finds the file or directory: "" is the root
+        DirNode<T>* find(const char* path) {
+            return find(path, strlen(path));
+        }
+
+        /// Finds the file or directory with the first len characters of path
+        DirNode<T>* find(const char* path, size_t len) {
+            return find(PathView(path, len));
+        }
+
+        /// Finds the file or directory: the path does not need to be zero
+        /// terminated
+        DirNode<T>* find(PathView path) {
+            if (path.empty()) return &root_node;
+            DirNode<T>* result = nullptr;
+            index.get(path.data(), path.size(), result);
+            return result;
+        }
+
+        /// Adds a file and the missing parent directories: returns nullptr if
+        /// the path is already used
+        DirNode<T>* add(const char* path, T* value) {
+            if (value == nullptr || find(path) != nullptr) return nullptr;
+            const char* slash = strrchr(path, '/');
+            DirNode<T>* parent = dir(path, slash == nullptr ? 0 : slash - path);
+            if (parent == nullptr) return nullptr;
+            DirNode<T>* node = new DirNode<T>();
+            node->name = path;
+            node->base_name = slash == nullptr ? path : slash + 1;
+            node->value = value;
+            link(parent, node);
+            return node;
+        }
+
+        /// Removes a file: the directories are kept
+        bool remove(const char* path) {
+            DirNode<T>* node = find(path);
+            if (node == nullptr || node->isDir()) return false;
+            DirNode<T>* parent = node->parent;
+            DirNode<T>* prev = nullptr;
+            for (DirNode<T>* p = parent->first_child; p != node; p = p->next_sibling) {
+                prev = p;
+            }
+            if (prev == nullptr) {
+                parent->first_child = node->next_sibling;
+            } else {
+                prev->next_sibling = node->next_sibling;
+            }
+            if (parent->last_child == node) {
+                parent->last_child = prev;
+            }
+            index.remove(node->name);
+            delete node;
+            return true;
+        }
+
+    protected:
+        DirNode<T> root_node;
+        HashIndex<DirNode<T>*> index;
+
+        // finds or creates the directory with the first len characters of path
+        DirNode<T>* dir(const char* path, size_t len) {
+            DirNode<T>* result = find(path, len);
+            if (result != nullptr) {
+                return result->isDir() ? result : nullptr;
+            }
+            size_t parent_len = len;
+            while (parent_len > 0 && path[parent_len - 1] != '/') parent_len--;
+            DirNode<T>* parent = dir(path, parent_len > 0 ? parent_len - 1 : 0);
+            if (parent == nullptr) return nullptr;
+            char* name = (char*)malloc(len + 1);
+            if (name == nullptr) return nullptr;
+            memcpy(name, path, len);
+            name[len] = 0;
+            result = new DirNode<T>();
+            result->name = name;
+            result->name_owned = true;
+            result->base_name = name + parent_len;
+            link(parent, result);
+            return result;
+        }
+
+        void link(DirNode<T>* parent, DirNode<T>* node) {
+            node->parent = parent;
+            if (parent->last_child == nullptr) {
+                parent->first_child = node;
+            } else {
+                parent->last_child->next_sibling = node;
+            }
+            parent->last_child = node;
+            index.put(node->name, node);
+        }
+
+        // deletes all children
+        void clear(DirNode<T>* node) {
+            DirNode<T>* child = node->first_child;
+            while (child != nullptr) {
+                DirNode<T>* next = child->next_sibling;
+                clear(child);
+                if (child->name_owned) free((void*)child->name);
+                delete child;
+                child = next;
+            }
+            node->first_child = nullptr;
+            node->last_child = nullptr;
+        }
+};
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace file_systems {
+
+/**
+ * @brief Open addressing hash table which maps a C string key to a value. The
+ * key is not copied: the ownership of the char* must be managed externally and
+ * it must stay valid as long as it is stored in the index!
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ */
+template <class T>
+class HashIndex {
+    public:
+        struct Slot {
+            const char* key = nullptr;
+            uint32_t hash = 0;
+            T value;
+        };
+
+        HashIndex() = default;
+        HashIndex(const HashIndex&) = delete;
+        HashIndex& operator=(const HashIndex&) = delete;
+
+        ~HashIndex() {
+            delete[] slots;
+        }
+
+        /// adds or replaces the value for the key
+        bool put(const char* key, T value) {
+            if (key == nullptr) return false;
+            if ((count + 1) * 4 > capacity * 3) {
+                if (!rehash(capacity == 0 ? 16 : capacity * 2)) return false;
+            }
+            uint32_t h = hash(key);
+            Slot* slot = find(key, h);
+            if (slot->key == nullptr) {
+                slot->key = key;
+                slot->hash = h;
+                count++;
+            }
+            slot->value = value;
+            return true;
+        }
+
+        /// provides the value for the key: returns false if not found
+        bool get(const char* key, T& value) {
+            if (key == nullptr) return false;
+            return get(key, strlen(key), value);
+        }
+
+        /// provides the value for the first len characters of the key
+        bool get(const char* key, size_t len, T& value) {
+            if (key == nullptr || count == 0) return false;
+            Slot* slot = find(key, len, hash(key, len));
+            if (slot->key == nullptr) return false;
+            value = slot->value;
+            return true;
+        }
+
+        /// removes the key: returns false if not found
+        bool remove(const char* key) {
+            if (key == nullptr || count == 0) return false;
+            Slot* slot = find(key, hash(key));
+            if (slot->key == nullptr) return false;
+            // backward shift deletion: move up the following entries of the
+            // probe sequence, so that no tombstones are needed
+            size_t mask = capacity - 1;
+            size_t hole = slot - slots;
+            size_t pos = (hole + 1) & mask;
+            while (slots[pos].key != nullptr) {
+                size_t home = slots[pos].hash & mask;
+                if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+                    slots[hole] = slots[pos];
+                    hole = pos;
+                }
+                pos = (pos + 1) & mask;
+            }
+            slots[hole] = Slot();
+            count--;
+            return true;
+        }
+
+        /// checks if the key is available
+        bool contains(const char* key) {
+            T tmp;
+            return get(key, tmp);
+        }
+
+        /// number of stored keys
+        size_t size() {
+            return count;
+        }
+
+        bool empty() {
+            return count == 0;
+        }
+
+        /// removes all entries but keeps the allocated table
+        void clear() {
+            for (size_t j = 0; j < capacity; j++) {
+                slots[j] = Slot();
+            }
+            count = 0;
+        }
+
+        /// FNV-1a hash of a zero terminated string
+        static uint32_t hash(const char* str) {
+            return hash(str, strlen(str));
+        }
+
+        /// FNV-1a hash of the first len characters
+        static uint32_t hash(const char* str, size_t len) {
+            uint32_t h = 2166136261u;
+            for (size_t j = 0; j < len; j++) {
+                h ^= (uint8_t)str[j];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+    protected:
+        Slot* slots = nullptr;
+        // number of slots: always a power of 2
+        size_t capacity = 0;
+        size_t count = 0;
+
+        // linear probing: returns the matching or the first empty slot
+        Slot* find(const char* key, uint32_t h) {
+            return find(key, strlen(key), h);
+        }
+
+        Slot* find(const char* key, size_t len, uint32_t h) {
+            size_t mask = capacity - 1;
+            size_t pos = h & mask;
+            while (true) {
+                Slot* slot = &slots[pos];
+                if (slot->key == nullptr) return slot;
+                if (slot->hash == h && strncmp(slot->key, key, len) == 0 &&
+                    slot->key[len] == 0)
+                    return slot;
+                pos = (pos + 1) & mask;
+            }
+        }
+
+        bool rehash(size_t newCapacity) {
+            Slot* old_slots = slots;
+            size_t old_capacity = capacity;
+            slots = new Slot[newCapacity];
+            if (slots == nullptr) {
+                slots = old_slots;
+                return false;
+            }
+            capacity = newCapacity;
+            for (size_t j = 0; j < old_capacity; j++) {
+                Slot& old = old_slots[j];
+                if (old.key != nullptr) {
+                    *find(old.key, old.hash) = old;
+                }
+            }
+            delete[] old_slots;
+            return true;
+        }
+};
+
+}
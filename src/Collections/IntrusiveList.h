@@ -0,0 +1,158 @@
+#pragma once
+#include <stddef.h>
+
+namespace file_systems {
+
+/**
+ * @brief Links which are embedded in the objects which are managed by an
+ * IntrusiveList: derive from this class.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T the derived class
+ */
+template <class T>
+struct IntrusiveListNode {
+    T* list_next = nullptr;
+    T* list_prior = nullptr;
+};
+
+/**
+ * @brief Double linked list which uses the links embedded in the objects
+ * (which must be derived from IntrusiveListNode<T>): adding and removing
+ * entries never allocates memory and an object can be removed w/o searching
+ * for it. The list does not own the objects and an object can only be in one
+ * list at a time.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ */
+template <class T>
+class IntrusiveList {
+    public:
+        class Iterator {
+            public:
+                Iterator(T* obj) {
+                    this->obj = obj;
+                }
+                inline Iterator operator++() {
+                    if (obj != nullptr) obj = obj->list_next;
+                    return *this;
+                }
+                inline Iterator operator++(int) {
+                    Iterator result = *this;
+                    ++*this;
+                    return result;
+                }
+                inline bool operator==(Iterator it) {
+                    return obj == it.obj;
+                }
+                inline bool operator!=(Iterator it) {
+                    return obj != it.obj;
+                }
+                inline T &operator*() {
+                    return *obj;
+                }
+                inline T *operator->() {
+                    return obj;
+                }
+            protected:
+                T* obj = nullptr;
+        };
+
+        IntrusiveList() = default;
+        IntrusiveList(const IntrusiveList&) = delete;
+        IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+        ~IntrusiveList() {
+            clear();
+        }
+
+        void push_back(T& obj) {
+            insert(nullptr, obj);
+        }
+
+        void push_front(T& obj) {
+            insert(head, obj);
+        }
+
+        /// inserts obj before pos: if pos is nullptr it is added at the end
+        void insert(T* pos, T& obj) {
+            T* prior = pos == nullptr ? tail : pos->list_prior;
+            obj.list_prior = prior;
+            obj.list_next = pos;
+            if (prior == nullptr) head = &obj; else prior->list_next = &obj;
+            if (pos == nullptr) tail = &obj; else pos->list_prior = &obj;
+            count++;
+        }
+
+        /// removes the object which must be part of this list
+        void remove(T& obj) {
+            if (obj.list_prior == nullptr) head = obj.list_next;
+            else obj.list_prior->list_next = obj.list_next;
+            if (obj.list_next == nullptr) tail = obj.list_prior;
+            else obj.list_next->list_prior = obj.list_prior;
+            obj.list_next = nullptr;
+            obj.list_prior = nullptr;
+            count--;
+        }
+
+        /// moves an entry of this list to the front (e.g. for a LRU order)
+        void moveToFront(T& obj) {
+            if (head == &obj) return;
+            remove(obj);
+            push_front(obj);
+        }
+
+        /// removes and returns the first entry or nullptr
+        T* pop_front() {
+            T* result = head;
+            if (result != nullptr) remove(*result);
+            return result;
+        }
+
+        /// removes and returns the last entry or nullptr
+        T* pop_back() {
+            T* result = tail;
+            if (result != nullptr) remove(*result);
+            return result;
+        }
+
+        /// first entry or nullptr
+        T* front() {
+            return head;
+        }
+
+        /// last entry or nullptr
+        T* back() {
+            return tail;
+        }
+
+        Iterator begin() {
+            return Iterator(head);
+        }
+
+        Iterator end() {
+            return Iterator(nullptr);
+        }
+
+        size_t size() {
+            return count;
+        }
+
+        bool empty() {
+            return count == 0;
+        }
+
+        /// unlinks all objects: they are not deleted
+        void clear() {
+            while (pop_front() != nullptr)
+                ;
+        }
+
+    protected:
+        T* head = nullptr;
+        T* tail = nullptr;
+        size_t count = 0;
+};
+
+}
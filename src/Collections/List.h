@@ -1,11 +1,16 @@
 #pragma once
 #include "InitializerList.h" 
+#include "Collections/ObjectPool.h"
+#include <assert.h>
 #include <stddef.h>
 
 namespace file_systems {
 
 /**
- * @brief Double linked list
+ * @brief Double linked list: the nodes are allocated on the heap or taken from
+ * an ObjectPool (see setPoolSize() and setPool()). Use the iterators to
+ * process the entries: operator[] needs to walk from the start. If the
+ * objects already contain the links use the IntrusiveList.
  * @author Phil Schatzmann
  * @copyright GPLv3
  * @tparam T 
@@ -96,8 +101,44 @@ class List {
 
         /// Default constructor
         List() { link(); };
-        /// copy constructor
-        List(const List&ref) = default;
+        /// copy constructor: the copy uses the heap for the nodes
+        List(const List&ref) {
+            link();
+            copy(ref);
+        }
+
+        ~List() {
+            clear();
+            if (owns_pool) delete p_pool;
+        }
+
+        List& operator=(const List&ref) {
+            if (this != &ref) {
+                clear();
+                copy(ref);
+            }
+            return *this;
+        }
+
+        /// Preallocates size nodes, so that adding entries does not need any
+        /// heap allocation: only possible while the list is empty
+        bool setPoolSize(int size, bool heapFallback = true) {
+            if (!empty()) return false;
+            if (owns_pool) delete p_pool;
+            p_pool = new ObjectPool<Node>(size, heapFallback);
+            owns_pool = p_pool != nullptr;
+            return p_pool != nullptr;
+        }
+
+        /// Uses a node pool which can be shared with other lists: only
+        /// possible while the list is empty
+        bool setPool(ObjectPool<Node> &pool) {
+            if (!empty()) return false;
+            if (owns_pool) delete p_pool;
+            p_pool = &pool;
+            owns_pool = false;
+            return true;
+        }
 
         /// Constructor using array
         template<size_t N>
@@ -112,24 +153,33 @@ class List {
   	    	    push_back(obj);
         } 
         
+        /// exchanges the entries (and the node pools)
         bool swap(List<T>&ref){
-            List<T> tmp(*this);
-            validate();
-
-            first = ref.first;
-            last = ref.last;
+            Node *this_first = empty() ? nullptr : first.next;
+            Node *this_last = empty() ? nullptr : last.prior;
+            Node *ref_first = ref.empty() ? nullptr : ref.first.next;
+            Node *ref_last = ref.empty() ? nullptr : ref.last.prior;
+            relink(ref_first, ref_last);
+            ref.relink(this_first, this_last);
+
+            size_t tmp_count = record_count;
             record_count = ref.record_count;
+            ref.record_count = tmp_count;
 
-            ref.first = tmp.first;
-            ref.last = tmp.last;
-            ref.record_count = tmp.record_count;
+            ObjectPool<Node> *tmp_pool = p_pool;
+            p_pool = ref.p_pool;
+            ref.p_pool = tmp_pool;
+            bool tmp_owns = owns_pool;
+            owns_pool = ref.owns_pool;
+            ref.owns_pool = tmp_owns;
 
             validate();
+            ref.validate();
             return true;
         }
 
         bool push_back(T data){
-            Node *node = new Node();
+            Node *node = createNode();
             if (node==nullptr) return false;
             node->data = data;
 
@@ -146,7 +196,7 @@ class List {
         }
 
         bool push_front(T data){
-            Node *node = new Node();
+            Node *node = createNode();
             if (node==nullptr) return false;
             node->data = data;
 
@@ -163,7 +213,7 @@ class List {
         }
 
         bool insert(Iterator it, const T& data){
-            Node *node = new Node();
+            Node *node = createNode();
             if (node==nullptr) return false;
             node->data = data;
 
@@ -205,7 +255,7 @@ class List {
             p_prior->next = p_next;
             p_next->prior = p_prior;
 
-            delete p_delete;
+            releaseNode(p_delete);
             record_count--;    
 
             validate();
@@ -225,7 +275,7 @@ class List {
             p_prior->next = p_next;
             p_next->prior = p_prior;
 
-            delete p_delete;
+            releaseNode(p_delete);
             record_count--;
 
             validate();
@@ -245,7 +295,7 @@ class List {
             p_prior->next = p_next;
             p_next->prior = p_prior;
 
-            delete p_delete;
+            releaseNode(p_delete);
             record_count--;    
             return true;
         }
@@ -271,6 +321,16 @@ class List {
             return it;
         }
 
+        /// first entry: the list must not be empty
+        T &front() {
+            return firstDataNode()->data;
+        }
+
+        /// last entry: the list must not be empty
+        T &back() {
+            return lastDataNode()->data;
+        }
+
         size_t size() {
             return record_count;
         }
@@ -286,6 +346,7 @@ class List {
             return true;
         }
 
+        /// entry by index: this needs to walk from the start!
         inline T &operator[](int index) {
             Node *n = firstDataNode();
             for (int j=0;j<index;j++){
@@ -302,12 +363,44 @@ class List {
         Node first; // empty dummy first node which which is always before the first data node 
         Node last; // empty dummy last node which which is always after the last data node 
         size_t record_count=0;
+        ObjectPool<Node> *p_pool = nullptr;
+        bool owns_pool = false;
 
         void link(){
             first.next = &last;
             last.prior = &first;
         }
 
+        // links the chain of nodes between the dummy nodes
+        void relink(Node *from, Node *to) {
+            if (from == nullptr) {
+                link();
+                return;
+            }
+            first.next = from;
+            from->prior = &first;
+            last.prior = to;
+            to->next = &last;
+        }
+
+        void copy(const List &ref) {
+            for (Node *n = ref.first.next; n != &ref.last; n = n->next) {
+                push_back(n->data);
+            }
+        }
+
+        Node *createNode() {
+            return p_pool != nullptr ? p_pool->create() : new Node();
+        }
+
+        void releaseNode(Node *node) {
+            if (p_pool != nullptr) {
+                p_pool->release(node);
+            } else {
+                delete node;
+            }
+        }
+
         Node* lastDataNode(){
             return last.prior;
         }
@@ -319,8 +412,8 @@ class List {
             assert(first.next!=nullptr);
             assert(last.prior!=nullptr);
             if (empty()){
-                assert(first.next = &last);
-                assert(last.prior = &first);
+                assert(first.next == &last);
+                assert(last.prior == &first);
             }
         }
 
@@ -0,0 +1,108 @@
+#pragma once
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace file_systems {
+
+/**
+ * @brief Fixed size pool of objects: The slab is allocated once at the first
+ * use and released objects are kept in a free list, so that create() and
+ * release() do not need any heap allocation. If the pool is exhausted we
+ * optionally fall back to new/delete.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ */
+template <class T>
+class ObjectPool {
+    public:
+        ObjectPool(int capacity = 0, bool heapFallback = true) {
+            this->capacity = capacity;
+            this->heap_fallback = heapFallback;
+        }
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        ~ObjectPool() {
+            delete[] slots;
+        }
+
+        /// Defines the number of pooled objects: this is only possible as long
+        /// as no pooled object is in use
+        bool setCapacity(int capacity, bool heapFallback = true) {
+            if (used > 0) return false;
+            delete[] slots;
+            slots = nullptr;
+            free_list = nullptr;
+            this->capacity = capacity;
+            this->heap_fallback = heapFallback;
+            return true;
+        }
+
+        /// Provides a new (default constructed) object or nullptr
+        T* create() {
+            if (slots == nullptr && capacity > 0) {
+                allocate();
+            }
+            if (free_list != nullptr) {
+                Slot* slot = free_list;
+                free_list = slot->next;
+                used++;
+                return new (slot->data) T();
+            }
+            return heap_fallback ? new T() : nullptr;
+        }
+
+        /// Destroys the object and gives the memory back to the pool
+        void release(T* obj) {
+            if (obj == nullptr) return;
+            if (isPooled(obj)) {
+                obj->~T();
+                Slot* slot = (Slot*)obj;
+                slot->next = free_list;
+                free_list = slot;
+                used--;
+            } else {
+                delete obj;
+            }
+        }
+
+        /// Checks if the object has been provided from the slab
+        bool isPooled(T* obj) {
+            return slots != nullptr && (Slot*)obj >= slots &&
+                   (Slot*)obj < slots + capacity;
+        }
+
+        /// Number of pooled objects
+        int size() {
+            return capacity;
+        }
+
+        /// Number of pooled objects which are in use
+        int usedCount() {
+            return used;
+        }
+
+    protected:
+        union Slot {
+            Slot* next;
+            alignas(T) uint8_t data[sizeof(T)];
+        };
+        Slot* slots = nullptr;
+        Slot* free_list = nullptr;
+        int capacity = 0;
+        int used = 0;
+        bool heap_fallback = true;
+
+        void allocate() {
+            slots = new Slot[capacity];
+            if (slots == nullptr) return;
+            for (int j = capacity - 1; j >= 0; j--) {
+                slots[j].next = free_list;
+                free_list = &slots[j];
+            }
+        }
+};
+
+}
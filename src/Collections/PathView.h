@@ -0,0 +1,160 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace file_systems {
+
+/**
+ * @brief Read only view of a path: a pointer and the cached length w/o
+ * virtual methods and w/o any allocation, so it can be created in each
+ * lookup. The chars are not copied and the view is not necessarily zero
+ * terminated (e.g. a component or the parent): use size() and do not pass
+ * data() to C string functions unless the view ends at the end of the
+ * original string!
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PathView {
+    public:
+        constexpr PathView() = default;
+
+        /// View on the first len characters of chars
+        constexpr PathView(const char* chars, size_t len) : chars(chars), len(len) {}
+
+        /// View on a zero terminated string
+        PathView(const char* chars) : chars(chars), len(chars == nullptr ? 0 : strlen(chars)) {}
+
+        constexpr const char* data() const {
+            return chars == nullptr ? "" : chars;
+        }
+
+        constexpr size_t size() const {
+            return len;
+        }
+
+        constexpr bool empty() const {
+            return len == 0;
+        }
+
+        constexpr char operator[](size_t idx) const {
+            return chars[idx];
+        }
+
+        /// checks if the path starts with the prefix
+        bool startsWith(PathView prefix) const {
+            return prefix.len <= len && memcmp(data(), prefix.data(), prefix.len) == 0;
+        }
+
+        /// checks if the path starts with the zero terminated prefix: no strlen
+        /// is needed for the prefix
+        bool startsWith(const char* prefix) const {
+            if (prefix == nullptr) return true;
+            for (size_t j = 0; prefix[j] != 0; j++) {
+                if (j >= len || chars[j] != prefix[j]) return false;
+            }
+            return true;
+        }
+
+        bool endsWith(char c) const {
+            return len > 0 && chars[len - 1] == c;
+        }
+
+        bool equals(PathView other) const {
+            return len == other.len && memcmp(data(), other.data(), len) == 0;
+        }
+
+        /// compares with a zero terminated string: no strlen is needed
+        bool equals(const char* other) const {
+            if (other == nullptr) return len == 0;
+            size_t j = 0;
+            for (; j < len; j++) {
+                if (other[j] != chars[j]) return false;
+            }
+            return other[j] == 0;
+        }
+
+        bool operator==(PathView other) const {
+            return equals(other);
+        }
+
+        bool operator!=(PathView other) const {
+            return !equals(other);
+        }
+
+        /// strcmp like ordering: < 0, 0 or > 0
+        int compare(PathView other) const {
+            size_t n = len < other.len ? len : other.len;
+            int result = memcmp(data(), other.data(), n);
+            if (result != 0) return result;
+            return len == other.len ? 0 : (len < other.len ? -1 : 1);
+        }
+
+        /// view starting at pos with max n characters
+        PathView substr(size_t pos, size_t n = (size_t)-1) const {
+            if (pos > len) pos = len;
+            if (n > len - pos) n = len - pos;
+            return PathView(data() + pos, n);
+        }
+
+        /// view w/o the first n characters
+        PathView removePrefix(size_t n) const {
+            return substr(n);
+        }
+
+        /// view w/o leading /
+        PathView trimLeadingSlash() const {
+            return len > 0 && chars[0] == '/' ? substr(1) : *this;
+        }
+
+        /// view w/o trailing /
+        PathView trimTrailingSlash() const {
+            return endsWith('/') ? PathView(chars, len - 1) : *this;
+        }
+
+        /// position of the last occurrence of c or -1
+        int lastIndexOf(char c) const {
+            for (size_t j = len; j > 0; j--) {
+                if (chars[j - 1] == c) return j - 1;
+            }
+            return -1;
+        }
+
+        /// the directory w/o trailing / ("" if there is none)
+        PathView parent() const {
+            int pos = lastIndexOf('/');
+            return pos < 0 ? PathView(chars, 0) : PathView(chars, pos);
+        }
+
+        /// the last component
+        PathView baseName() const {
+            return substr(lastIndexOf('/') + 1);
+        }
+
+        /// Provides the next component starting at pos and moves pos behind
+        /// it: returns false at the end
+        bool nextComponent(size_t& pos, PathView& component) const {
+            while (pos < len && chars[pos] == '/') pos++;
+            if (pos >= len) return false;
+            size_t start = pos;
+            while (pos < len && chars[pos] != '/') pos++;
+            component = PathView(chars + start, pos - start);
+            return true;
+        }
+
+        /// FNV-1a hash: the same value as HashIndex::hash()
+        uint32_t hash() const {
+            uint32_t h = 2166136261u;
+            for (size_t j = 0; j < len; j++) {
+                h ^= (uint8_t)chars[j];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+    protected:
+        const char* chars = nullptr;
+        size_t len = 0;
+};
+
+}
@@ -4,7 +4,8 @@
 namespace file_systems {
 
 /**
- * @brief FIFO Queue which is based on a List
+ * @brief FIFO Queue which is based on a List: each entry is allocated. Use
+ * RingQueue or SPSCQueue if the max size is known.
  * @author Phil Schatzmann
  * @copyright GPLv3
  * @tparam T 
@@ -19,8 +20,8 @@ class Queue {
         }
 
         bool peek(T& data){
-            if (l.end()->prior==nullptr) return false;
-            data = *(l.end()->prior);
+            if (l.empty()) return false;
+            data = l.back();
             return true;
         }
 
@@ -32,6 +33,11 @@ class Queue {
             return l.size();
         }
 
+        /// Preallocates the nodes for size entries: must be called while empty
+        bool setPoolSize(int size, bool heapFallback = true) {
+            return l.setPoolSize(size, heapFallback);
+        }
+
         bool clear() {
             return l.clear();
         }
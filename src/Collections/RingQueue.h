@@ -0,0 +1,239 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__has_include)
+#  if __has_include(<atomic>)
+#    include <atomic>
+#    define FS_HAS_STD_ATOMIC 1
+#  endif
+#endif
+
+namespace file_systems {
+
+/**
+ * @brief Position of a SPSCQueue which is always atomic (independent of
+ * FS_THREAD_SAFE): it is published with release and read with acquire
+ * semantics. Platforms w/o <atomic> (e.g. AVR) use the compiler builtins.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class SPSCPosition {
+public:
+  uint32_t load() const {
+#if FS_HAS_STD_ATOMIC
+    return value.load(std::memory_order_acquire);
+#else
+    return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+#endif
+  }
+
+  void store(uint32_t pos) {
+#if FS_HAS_STD_ATOMIC
+    value.store(pos, std::memory_order_release);
+#else
+    __atomic_store_n(&value, pos, __ATOMIC_RELEASE);
+#endif
+  }
+
+protected:
+#if FS_HAS_STD_ATOMIC
+  std::atomic<uint32_t> value{0};
+#else
+  uint32_t value = 0;
+#endif
+};
+
+/**
+ * @brief FIFO Queue with a fixed capacity which stores the values in a
+ * contiguous ring buffer: enqueue and dequeue never allocate any memory.
+ * The positions are free running counters, so all N entries can be used.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ * @tparam N capacity: must be a power of 2
+ */
+template <class T, size_t N>
+class RingQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of 2");
+
+    public:
+        RingQueue() = default;
+
+        bool enqueue(const T& data){
+            if (full()) return false;
+            values[tail & (N - 1)] = data;
+            tail++;
+            return true;
+        }
+
+        bool peek(T& data){
+            if (empty()) return false;
+            data = values[head & (N - 1)];
+            return true;
+        }
+
+        bool dequeue(T& data){
+            if (!peek(data)) return false;
+            head++;
+            return true;
+        }
+
+        size_t size() {
+            return tail - head;
+        }
+
+        bool clear() {
+            head = tail = 0;
+            return true;
+        }
+
+        bool empty() {
+            return head == tail;
+        }
+
+        bool full() {
+            return size() == N;
+        }
+
+        constexpr size_t capacity() {
+            return N;
+        }
+
+    protected:
+        T values[N];
+        uint32_t head = 0;
+        uint32_t tail = 0;
+};
+
+/**
+ * @brief Lock free FIFO Queue for exactly one producer task and one consumer
+ * task (e.g. a task which reads a file and a task which plays the data): the
+ * values are stored in a ring buffer with a fixed capacity and the positions
+ * are published with release and read with acquire semantics. Each side caches
+ * the position of the other side, so that it only needs to read the shared
+ * position when the queue seems to be full or empty. The synchronization
+ * between tasks needs FS_THREAD_SAFE.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ * @tparam N capacity: must be a power of 2
+ */
+template <class T, size_t N>
+class SPSCQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of 2");
+
+    public:
+        SPSCQueue() = default;
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+        /// Producer: adds a value, returns false if the queue is full
+        bool enqueue(const T& data){
+            uint32_t pos = tail.load();
+            if (available(pos, 1) == 0) return false;
+            values[pos & (N - 1)] = data;
+            tail.store(pos + 1);
+            return true;
+        }
+
+        /// Producer: adds up to len values and returns the number of added values
+        size_t write(const T* data, size_t len){
+            uint32_t pos = tail.load();
+            size_t n = available(pos, len);
+            if (n > len) n = len;
+            for (size_t j = 0; j < n; j++) {
+                values[(pos + j) & (N - 1)] = data[j];
+            }
+            tail.store(pos + n);
+            return n;
+        }
+
+        /// Consumer: provides the oldest value w/o removing it
+        bool peek(T& data){
+            uint32_t pos = head.load();
+            if (filled(pos, 1) == 0) return false;
+            data = values[pos & (N - 1)];
+            return true;
+        }
+
+        /// Consumer: removes the oldest value, returns false if the queue is empty
+        bool dequeue(T& data){
+            uint32_t pos = head.load();
+            if (filled(pos, 1) == 0) return false;
+            data = values[pos & (N - 1)];
+            head.store(pos + 1);
+            return true;
+        }
+
+        /// Consumer: removes up to len values and returns the number of values
+        size_t read(T* data, size_t len){
+            uint32_t pos = head.load();
+            size_t n = filled(pos, len);
+            if (n > len) n = len;
+            for (size_t j = 0; j < n; j++) {
+                data[j] = values[(pos + j) & (N - 1)];
+            }
+            head.store(pos + n);
+            return n;
+        }
+
+        /// Number of values: this is only a snapshot if the other side is active
+        size_t size() {
+            return tail.load() - head.load();
+        }
+
+        /// Consumer: removes all values
+        bool clear() {
+            uint32_t pos = tail.load();
+            cached_tail = pos;
+            head.store(pos);
+            return true;
+        }
+
+        bool empty() {
+            return size() == 0;
+        }
+
+        bool full() {
+            return size() == N;
+        }
+
+        constexpr size_t capacity() {
+            return N;
+        }
+
+    protected:
+        T values[N];
+        // position of the next value to read: written by the consumer
+        SPSCPosition head;
+        // position of the next value to write: written by the producer
+        SPSCPosition tail;
+        // last head which was seen by the producer
+        uint32_t cached_head = 0;
+        // last tail which was seen by the consumer
+        uint32_t cached_tail = 0;
+
+        // free entries for the producer: the head is only read if the cached
+        // value does not provide enough space
+        size_t available(uint32_t pos, size_t wanted) {
+            size_t result = N - (pos - cached_head);
+            if (result < wanted) {
+                cached_head = head.load();
+                result = N - (pos - cached_head);
+            }
+            return result;
+        }
+
+        // filled entries for the consumer: the tail is only read if the
+        // cached value does not provide enough values
+        size_t filled(uint32_t pos, size_t wanted) {
+            size_t result = cached_tail - pos;
+            if (result < wanted) {
+                cached_tail = tail.load();
+                result = cached_tail - pos;
+            }
+            return result;
+        }
+};
+
+}
@@ -23,8 +23,8 @@ class Stack {
         }
 
         bool peek(T& data){
-            if (l.end()->prior==nullptr) return false;
-            data = *(l.end()->prior);
+            if (l.empty()) return false;
+            data = l.back();
             return true;
         }
 
@@ -32,6 +32,11 @@ class Stack {
             return l.size();
         }
 
+        /// Preallocates the nodes for size entries: must be called while empty
+        bool setPoolSize(int size, bool heapFallback = true) {
+            return l.setPoolSize(size, heapFallback);
+        }
+
         bool clear() {
             return l.clear();
         }
@@ -1,19 +1,40 @@
 #pragma once
 #include <assert.h>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
 #ifdef USE_INITIALIZER_LIST
-#include "InitializerList.h" 
+#include "InitializerList.h"
 #endif
 namespace file_systems {
 
 /**
- * @brief Vector implementation which provides the most important methods as defined by std::vector. This class it is quite handy 
+ * @brief Inline storage of a Vector for N elements
+ */
+template <class T, size_t N>
+struct VectorStorage {
+  alignas(T) uint8_t inline_data[N * sizeof(T)];
+  T *inlineData() { return (T *)inline_data; }
+};
+
+/// No inline storage: all elements are on the heap
+template <class T>
+struct VectorStorage<T, 0> {
+  T *inlineData() { return nullptr; }
+};
+
+/**
+ * @brief Vector implementation which provides the most important methods as defined by std::vector. This class it is quite handy
  * to have and most of the times quite better then dealing with raw c arrays.
+ * The first N elements are stored inline, so that small vectors do not need
+ * any heap allocation. The heap buffer grows geometrically and the elements
+ * are moved when the buffer is reallocated.
  *
  * @author Phil Schatzmann
  * @copyright GPLv3
  **/
 
-template <class T> 
+template <class T, size_t N = 0>
 class Vector {
   public:
   /**
@@ -59,8 +80,7 @@ class Vector {
           return *this;
         }
         inline iterator operator+(int offset) {
-          pos_ += offset;
-          return iterator(ptr+offset, offset);
+          return iterator(ptr+offset, pos_+offset);
         }
         inline bool operator==(iterator it) {
           return ptr == it.getPtr();
@@ -99,128 +119,149 @@ class Vector {
 
     /// support for initializer_list
     inline Vector(std::initializer_list<T> iniList) {
-      resize(iniList.size());
-      int pos = 0;
+      reserve(iniList.size());
       for (auto &obj : iniList){
-        p_data[pos++] = obj;
+        push_back(obj);
       }
-    } 
+    }
 
 #endif
 
-    /// default constructor
-    inline Vector(size_t len = 20) {
-      resize_internal(len, false);
+    /// default constructor: len is the initial capacity. Nothing is
+    /// allocated as long as it fits into the inline storage
+    inline Vector(size_t len = 0) {
+      reserve(len);
     }
 
     /// allocate size and initialize array
     inline Vector(int size, T value) {
-      resize(size);
-      for (int j=0;j< size;j++){
-        p_data[j] = value;
-      }
+      assign(size, value);
     }
 
-    inline Vector(Vector<T> &&moveFrom) = default;
-
+    /// move constructor: the heap buffer is taken over, inline elements are
+    /// moved
+    inline Vector(Vector &&moveFrom) {
+      take(moveFrom);
+    }
 
     /// copy constructor
-    inline Vector(Vector<T> &copyFrom) {
-      resize_internal(copyFrom.size(), false);
-      for (int j=0;j<copyFrom.size();j++){
-        p_data[j] = copyFrom[j];
-      }
-      this->len = copyFrom.size();
+    inline Vector(const Vector &copyFrom) {
+      copy(copyFrom);
     }
 
     /// legacy constructor with pointer range
     inline Vector(T *from, T *to) {
-      this->len = to - from; 
-      resize_internal(this->len, false);
-      for (size_t j=0;j<this->len;j++){
-        p_data[j] = from[j];
+      reserve(to - from);
+      for (T *p = from; p < to; p++){
+        push_back(*p);
       }
     }
 
     /// Destructor
     inline  ~Vector() {
       clear();
-      shrink_to_fit();
-      delete [] this->p_data;
+      release();
     }
 
+    /// removes all elements: the capacity is kept
     inline void clear() {
+      for (int j=0;j<len;j++){
+        p_data[j].~T();
+      }
       len = 0;
     }
-    
+
     inline int size() {
       return len;
     }
-    
+
     inline bool empty() {
         return size()==0;
     }
 
-    inline void push_back(T value){
-      resize_internal(len+1, true);
-      p_data[len] = value;
+    /// makes sure that we can store newCapacity elements w/o reallocation
+    inline bool reserve(size_t newCapacity) {
+      if ((int)newCapacity <= bufferLen) return true;
+      return reallocate(newCapacity);
+    }
+
+    inline bool push_back(const T &value){
+      if (len == bufferLen && &value >= p_data && &value < p_data + len) {
+        // the value would be moved by the reallocation
+        T tmp(value);
+        return push_back(static_cast<T&&>(tmp));
+      }
+      if (!grow(len+1)) return false;
+      new (p_data + len) T(value);
+      len++;
+      return true;
+    }
+
+    inline bool push_back(T &&value){
+      if (!grow(len+1)) return false;
+      new (p_data + len) T(static_cast<T&&>(value));
+      len++;
+      return true;
+    }
+
+    /// constructs the new last element in place
+    template <class... Args>
+    inline bool emplace_back(Args &&...args){
+      if (!grow(len+1)) return false;
+      new (p_data + len) T(static_cast<Args&&>(args)...);
       len++;
+      return true;
     }
 
-    inline void push_front(T value){
-      resize_internal(len+1, true);
-      memmove(p_data,p_data+1,len*sizeof(T));
-      p_data[0] = value;
+    inline bool push_front(T value){
+      if (!grow(len+1)) return false;
+      if (len == 0) {
+        new (p_data) T(static_cast<T&&>(value));
+      } else {
+        new (p_data + len) T(static_cast<T&&>(p_data[len-1]));
+        for (int j=len-1;j>0;j--){
+          p_data[j] = static_cast<T&&>(p_data[j-1]);
+        }
+        p_data[0] = static_cast<T&&>(value);
+      }
       len++;
+      return true;
     }
 
     inline void pop_back(){
         if (len>0) {
           len--;
+          p_data[len].~T();
         }
     }
 
     inline void pop_front(){
         if (len>0) {
-          len--;
-          if (len>0){
-            memmove(p_data, p_data+1,len*sizeof(T));
-          }
+          erase(begin());
         }
     }
 
 
     inline void assign(iterator v1, iterator v2) {
-        size_t newLen = v2 - v1; 
-        resize_internal(newLen, false);
-        this->len = newLen;
-        int pos = 0;
+        clear();
+        reserve(v2 - v1);
         for (auto ptr = v1; ptr != v2; ptr++) {
-            p_data[pos++] = *ptr;
-        }    
+            push_back(*ptr);
+        }
     }
 
     inline void assign(size_t number, T value) {
-        resize_internal(number, false);
-        this->len = number;
-        for (int j=0;j<number;j++){
-            p_data[j]=value;
+        clear();
+        reserve(number);
+        for (size_t j=0;j<number;j++){
+            push_back(value);
         }
     }
 
-    inline void swap(Vector<T> &in){
-      // save data
-      T *dataCpy = p_data;
-      int bufferLenCpy = bufferLen;
-      int lenCpy = len;
-      // swap this
-      p_data = in.p_data;
-      len = in.len;
-      bufferLen = in.bufferLen;
-      // swp in
-      in.p_data = dataCpy;
-      in.len = lenCpy;
-      in.bufferLen = bufferLenCpy;
+    inline void swap(Vector &in){
+      Vector tmp(static_cast<Vector&&>(in));
+      in = static_cast<Vector&&>(*this);
+      *this = static_cast<Vector&&>(tmp);
     }
 
     inline T &operator[](int index) {
@@ -228,16 +269,24 @@ class Vector {
       return p_data[index];
     }
 
-    inline Vector<T> &operator=(Vector<T> &copyFrom) {
-      resize_internal(copyFrom.size(), false);
-      for (int j=0;j<copyFrom.size();j++){
-        p_data[j] = copyFrom[j];
+    inline Vector &operator=(const Vector &copyFrom) {
+      if (this != &copyFrom) {
+        clear();
+        copy(copyFrom);
+      }
+      return *this;
+    }
+
+    inline Vector &operator=(Vector &&moveFrom) {
+      if (this != &moveFrom) {
+        clear();
+        release();
+        take(moveFrom);
       }
-      this->len = copyFrom.size();
       return *this;
     }
 
-    inline T &operator[] (const int index) const {
+    inline const T &operator[] (const int index) const {
       return p_data[index];
     }
 
@@ -251,8 +300,11 @@ class Vector {
       return false;
     }
 
+    /// releases the unused heap memory (and moves the elements back to the
+    /// inline storage if they fit)
     inline void shrink_to_fit() {
-        resize_internal(this->len, true, true);
+      if (p_data == storage.inlineData() || len == bufferLen) return;
+      reallocate(len);
     }
 
     int capacity(){
@@ -261,11 +313,18 @@ class Vector {
 
     inline bool resize(int newSize){
         int oldSize = this->len;
-        resize_internal(newSize, true);
-        this->len = newSize;        
+        if (newSize < 0) newSize = 0;
+        if (!reserve(newSize)) return false;
+        while (len > newSize) {
+          pop_back();
+        }
+        while (len < newSize) {
+          new (p_data + len) T();
+          len++;
+        }
         return this->len!=oldSize;
     }
-                       
+
     inline iterator begin(){
       return iterator(p_data, 0);
     }
@@ -282,14 +341,12 @@ class Vector {
     inline void erase(iterator it) {
       int pos = it.pos();
       if (pos<len){
-          int lenToEnd = len - pos - 1;
-          // call destructor on data to be erased
-          p_data[pos].~T();
           // shift values by 1 position
-          memmove((void*) &p_data[pos],(void*)(&p_data[pos+1]),lenToEnd*sizeof(T));
-          // make sure that we have a valid object at the end
-          p_data[len-1] = T();
+          for (int j=pos;j<len-1;j++){
+            p_data[j] = static_cast<T&&>(p_data[j+1]);
+          }
           len--;
+          p_data[len].~T();
       }
     }
 
@@ -298,36 +355,72 @@ class Vector {
     }
 
   protected:
-    int bufferLen=0;
+    VectorStorage<T, N> storage;
+    int bufferLen = N;
     int len = 0;
-    T *p_data = nullptr;
-
-    inline void resize_internal(int newSize, bool copy, bool shrink=false)  {
-      if (newSize<=0) return;
-      //bool withNewSize = false;
-      if (newSize>bufferLen || this->p_data==nullptr ||shrink){
-        //withNewSize = true;            
-        T* oldData = p_data;
-        int oldBufferLen = this->bufferLen;
-        this->p_data = new T[newSize+1];
-        this->bufferLen = newSize;  
-        if (oldData != nullptr) {
-          if(copy && this->len > 0){
-              memcpy((void*)p_data,(void*) oldData, this->len*sizeof(T));
-          }
-          if (shrink){
-            cleanup(oldData, newSize, oldBufferLen);
-          }
-          delete [] oldData;            
-        }  
-      }
+    T *p_data = storage.inlineData();
+
+    // makes sure that there is space for newLen elements: the capacity is
+    // doubled to keep push_back in amortized constant time
+    inline bool grow(int newLen) {
+      if (newLen <= bufferLen) return true;
+      int newCapacity = bufferLen < 4 ? 4 : bufferLen * 2;
+      return reallocate(newCapacity < newLen ? newLen : newCapacity);
     }
 
-    void cleanup(T*p_data, int from, int to){
-      for (int j=from;j<to;j++){
+    // moves the elements into a new buffer with the indicated capacity
+    inline bool reallocate(int newCapacity) {
+      T *new_data = storage.inlineData();
+      if (newCapacity > (int)N) {
+        new_data = (T *)::operator new(sizeof(T) * newCapacity, std::nothrow);
+        if (new_data == nullptr) return false;
+      } else {
+        newCapacity = N;
+      }
+      if (new_data == p_data) return true;
+      for (int j=0;j<len;j++){
+        new (new_data + j) T(static_cast<T&&>(p_data[j]));
         p_data[j].~T();
       }
+      release();
+      p_data = new_data;
+      bufferLen = newCapacity;
+      return true;
+    }
+
+    // frees the heap buffer: the elements must have been destroyed or moved
+    inline void release() {
+      if (p_data != storage.inlineData()) {
+        ::operator delete(p_data);
+      }
+      p_data = storage.inlineData();
+      bufferLen = N;
+    }
+
+    inline void copy(const Vector &copyFrom) {
+      reserve(copyFrom.len);
+      for (int j=0;j<copyFrom.len;j++){
+        push_back(copyFrom.p_data[j]);
+      }
+    }
+
+    // takes over the heap buffer or moves the inline elements
+    inline void take(Vector &moveFrom) {
+      if (moveFrom.p_data != moveFrom.storage.inlineData()) {
+        p_data = moveFrom.p_data;
+        bufferLen = moveFrom.bufferLen;
+        len = moveFrom.len;
+        moveFrom.p_data = moveFrom.storage.inlineData();
+        moveFrom.bufferLen = N;
+        moveFrom.len = 0;
+        return;
+      }
+      for (int j=0;j<moveFrom.len;j++){
+        new (p_data + j) T(static_cast<T&&>(moveFrom.p_data[j]));
+      }
+      len = moveFrom.len;
+      moveFrom.clear();
     }
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "Compression/LZ4Block.h"
+
+#define FS_COMPRESSED_MAGIC "FSZ1"
+
+namespace file_systems {
+
+/**
+ * @brief Header of compressed content: it is followed by the block index
+ * (block_count + 1 uint32_t offsets of the blocks relative to the start of
+ * the block data) and the LZ4 compressed blocks. A block which has the same
+ * size compressed and uncompressed is stored w/o compression. All values
+ * are little endian.
+ */
+struct CompressedHeader {
+  char magic[4];
+  uint32_t block_size;
+  uint32_t size;
+  uint32_t block_count;
+};
+
+/**
+ * @brief Read access to compressed content: every block can be decompressed
+ * individually, so that we do not need to start from the beginning when we
+ * move to a new position.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class CompressedBlocks {
+public:
+  CompressedBlocks(const uint8_t *data, size_t len) {
+    if (data == nullptr || len < sizeof(CompressedHeader)) return;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, FS_COMPRESSED_MAGIC, 4) != 0 ||
+        header.block_size == 0 ||
+        header.block_count !=
+            (header.size + header.block_size - 1) / header.block_size)
+      return;
+    size_t index_len = (header.block_count + 1) * sizeof(uint32_t);
+    if (len < sizeof(header) + index_len) return;
+    p_index = data + sizeof(header);
+    p_blocks = p_index + index_len;
+    blocks_len = len - sizeof(header) - index_len;
+    if (offset(header.block_count) > blocks_len) p_index = nullptr;
+  }
+
+  /// true if the content has a valid header
+  operator bool() { return p_index != nullptr; }
+
+  /// uncompressed size
+  size_t size() { return header.size; }
+
+  /// uncompressed size of a block
+  size_t blockSize() { return header.block_size; }
+
+  /// number of blocks
+  size_t blockCount() { return header.block_count; }
+
+  /// uncompressed size of the indicated block
+  size_t blockLen(size_t idx) {
+    size_t start = idx * header.block_size;
+    return header.size - start < header.block_size ? header.size - start
+                                                   : header.block_size;
+  }
+
+  /// decompresses the indicated block into the buffer of blockSize() bytes:
+  /// returns the number of bytes or -1 on error
+  int readBlock(size_t idx, uint8_t *buffer) {
+    if (p_index == nullptr || idx >= header.block_count) return -1;
+    uint32_t start = offset(idx);
+    uint32_t end = offset(idx + 1);
+    if (end < start || end > blocks_len) return -1;
+    size_t len = blockLen(idx);
+    if (end - start == len) {
+      memcpy(buffer, p_blocks + start, len);
+      return len;
+    }
+    int result = lz4DecompressBlock(p_blocks + start, end - start, buffer, len);
+    return result == (int)len ? result : -1;
+  }
+
+protected:
+  CompressedHeader header = {{0}, 0, 0, 0};
+  const uint8_t *p_index = nullptr;
+  const uint8_t *p_blocks = nullptr;
+  size_t blocks_len = 0;
+
+  uint32_t offset(size_t idx) {
+    uint32_t result;
+    memcpy(&result, p_index + idx * sizeof(uint32_t), sizeof(result));
+    return result;
+  }
+};
+
+} // namespace file_systems
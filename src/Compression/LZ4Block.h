@@ -0,0 +1,149 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace file_systems {
+
+/**
+ * @brief Decoder for the LZ4 block format: all accesses are checked against
+ * the source and target size, so corrupted data can not write outside of the
+ * target buffer.
+ * @return number of decompressed bytes or -1 if the data is invalid
+ */
+inline int lz4DecompressBlock(const uint8_t *src, size_t srcLen, uint8_t *dst,
+                              size_t dstLen) {
+  const uint8_t *ip = src;
+  const uint8_t *iend = src + srcLen;
+  uint8_t *op = dst;
+  uint8_t *oend = dst + dstLen;
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    // literals
+    size_t lit_len = token >> 4;
+    if (lit_len == 15) {
+      uint8_t b;
+      do {
+        if (ip >= iend) return -1;
+        b = *ip++;
+        lit_len += b;
+      } while (b == 255);
+    }
+    if (lit_len > (size_t)(iend - ip) || lit_len > (size_t)(oend - op))
+      return -1;
+    memcpy(op, ip, lit_len);
+    op += lit_len;
+    ip += lit_len;
+    // the last sequence has no match
+    if (ip >= iend) break;
+    // match
+    if (iend - ip < 2) return -1;
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst)) return -1;
+    size_t match_len = token & 15;
+    if (match_len == 15) {
+      uint8_t b;
+      do {
+        if (ip >= iend) return -1;
+        b = *ip++;
+        match_len += b;
+      } while (b == 255);
+    }
+    match_len += 4;
+    if (match_len > (size_t)(oend - op)) return -1;
+    const uint8_t *match = op - offset;
+    if (offset >= match_len) {
+      memcpy(op, match, match_len);
+    } else {
+      // overlapping copy: repeats the last offset bytes
+      for (size_t j = 0; j < match_len; j++) op[j] = match[j];
+    }
+    op += match_len;
+  }
+  return op - dst;
+}
+
+/// Max size of the result of lz4CompressBlock
+inline size_t lz4CompressBound(size_t len) { return len + len / 255 + 16; }
+
+/**
+ * @brief Greedy LZ4 block compressor which is intended to be used by host
+ * tools: it needs 16 KBytes of stack.
+ * @return number of compressed bytes or -1 if dst is too small
+ */
+inline int lz4CompressBlock(const uint8_t *src, size_t len, uint8_t *dst,
+                            size_t dstLen) {
+  const int hash_bits = 12;
+  // position + 1 of the last occurrence of a 4 byte sequence
+  uint32_t table[1 << hash_bits] = {0};
+  uint8_t *op = dst;
+  uint8_t *oend = dst + dstLen;
+  size_t anchor = 0;
+  size_t pos = 0;
+
+  // writes a length extension
+  auto writeLen = [&](size_t value) -> bool {
+    while (value >= 255) {
+      if (op >= oend) return false;
+      *op++ = 255;
+      value -= 255;
+    }
+    if (op >= oend) return false;
+    *op++ = (uint8_t)value;
+    return true;
+  };
+  // writes the literals since the anchor and the match (if match_len > 0)
+  auto writeSequence = [&](size_t offset, size_t match_len) -> bool {
+    size_t lit_len = pos - anchor;
+    if (op >= oend) return false;
+    uint8_t *token = op++;
+    *token = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15 && !writeLen(lit_len - 15)) return false;
+    if (lit_len > (size_t)(oend - op)) return false;
+    memcpy(op, src + anchor, lit_len);
+    op += lit_len;
+    if (match_len == 0) return true;
+    if (oend - op < 2) return false;
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    size_t code = match_len - 4;
+    *token |= code < 15 ? code : 15;
+    if (code >= 15 && !writeLen(code - 15)) return false;
+    return true;
+  };
+
+  // the format requires the last 5 bytes to be literals and the last match
+  // to start at least 12 bytes before the end
+  if (len >= 13) {
+    size_t match_limit = len - 12;
+    size_t end_limit = len - 5;
+    while (pos < match_limit) {
+      uint32_t seq;
+      memcpy(&seq, src + pos, 4);
+      uint32_t h = (seq * 2654435761u) >> (32 - hash_bits);
+      size_t ref = table[h];
+      table[h] = pos + 1;
+      if (ref > 0 && pos - (ref - 1) <= 0xFFFF &&
+          memcmp(src + ref - 1, src + pos, 4) == 0) {
+        size_t match_pos = ref - 1;
+        size_t match_len = 4;
+        while (pos + match_len < end_limit &&
+               src[match_pos + match_len] == src[pos + match_len]) {
+          match_len++;
+        }
+        if (!writeSequence(pos - match_pos, match_len)) return -1;
+        pos += match_len;
+        anchor = pos;
+      } else {
+        pos++;
+      }
+    }
+  }
+  // last literals
+  pos = len;
+  if (!writeSequence(0, 0)) return -1;
+  return op - dst;
+}
+
+} // namespace file_systems
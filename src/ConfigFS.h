@@ -13,20 +13,35 @@
 #ifdef IS_DESKTOP
 #  include <sys/stat.h>
 #  include <dirent.h>
+#  include <fcntl.h>
 #  ifndef POSIX_C_METHOD_IMPLEMENTATION
 #    define POSIX_C_METHOD_IMPLEMENTATION 1
 #  endif
 #  define FS_USE_F_INTERNAL
+// FileSystemSD uses the Arduino SD API (see tools/sd-host)
+#  define FILE_MODE_CHR
+#  ifndef FS_THREAD_SAFE
+#    define FS_THREAD_SAFE 1
+#  endif
+// <mutex> includes <cstdio> which would undefine the fopen... replacements
+#  if FS_THREAD_SAFE
+#    include <atomic>
+#    include <mutex>
+#  endif
 #  include "ConfigFS/fs_stdio.h"
 #endif
 
 // ********** ESP33 **************
 #ifdef ESP32
 #  define POSIX_C_METHOD_IMPLEMENTATION 0
+#  ifndef FS_THREAD_SAFE
+#    define FS_THREAD_SAFE 1
+#  endif
 #  define FILE_MODE_STR
 #  define SEEK_MODE_SUPPORTED
 #  define USE_DUMMY_SD_IMPL
 #  define SUPPORTS_SD
+#  include <fcntl.h>
 #  include "esp_vfs.h"
 #endif
 
@@ -59,6 +74,7 @@ struct DIR_impl {
 #  define POSIX_C_METHOD_IMPLEMENTATION 1
 #  define FILE_MODE_CHR
 #  include "sys/stat.h"
+#  include <fcntl.h>
 #  include "ConfigFS/fs_dirent.h"
 #  include "ConfigFS/fs_stdio.h"
 #endif
@@ -70,7 +86,18 @@ struct DIR_impl {
 #  define off_t long
 #  define FILENAME_MAX 80
 #  define FS_LOGGING_ACTIVE 0
+#  define FS_OPEN_FILES_POOL_SIZE 2
+#  define FS_FD_SEGMENTS 4
+#  define FS_FD_SEGMENT_SIZE 4
+#  define FS_FILE_BUFFER_SIZE 32
+#  define FS_RAM_CHUNK_SIZE 32
+#  define FS_RAM_CHUNK_POOL_SIZE 0
+#  define FS_SD_CACHE_BLOCKS 0
+#  define FS_SD_WRITE_BUFFER_SIZE 0
+#  define FS_SD_STAT_CACHE_SIZE 0
+#  define FS_SD_DIR_CACHE_SIZE 0
 #  include "ConfigFS/fs_dirent.h"
+#  include "ConfigFS/fs_fcntl.h"
 #  include "ConfigFS/fs_stat.h"
 #  include "ConfigFS/fs_stdio.h"
 #endif
@@ -79,6 +106,107 @@ struct DIR_impl {
 #  define FS_LOGGING_ACTIVE 1
 #endif
 
+// Log calls below this level are not compiled: 0=Debug, 1=Info, 2=Warning,
+// 3=Error. The level which is set with FSLogger.begin() is applied to the rest.
+#ifndef FS_LOG_MIN_LEVEL
+#  define FS_LOG_MIN_LEVEL 0
+#endif
+
+// Protect the registry with a mutex
+#ifndef FS_THREAD_SAFE
+#  define FS_THREAD_SAFE 0
+#endif
+
+// Max number of open files is FS_FD_SEGMENTS * FS_FD_SEGMENT_SIZE
+#ifndef FS_FD_SEGMENTS
+#  define FS_FD_SEGMENTS 16
+#endif
+#ifndef FS_FD_SEGMENT_SIZE
+#  define FS_FD_SEGMENT_SIZE 16
+#endif
+
+// Number of preallocated open file entries (additional files use the heap)
+#ifndef FS_OPEN_FILES_POOL_SIZE
+#  define FS_OPEN_FILES_POOL_SIZE 10
+#endif
+
+// Default buffer size for the FILE of the fopen_i... replacements
+#ifndef FS_FILE_BUFFER_SIZE
+#  define FS_FILE_BUFFER_SIZE 512
+#endif
+
+// Size of the blocks which store the data of writable in memory files
+#ifndef FS_RAM_CHUNK_SIZE
+#  define FS_RAM_CHUNK_SIZE 256
+#endif
+
+// Number of preallocated blocks for writable in memory files (additional
+// blocks use the heap)
+#ifndef FS_RAM_CHUNK_POOL_SIZE
+#  define FS_RAM_CHUNK_POOL_SIZE 16
+#endif
+
+// Deferred logging: number of messages in the ring buffer (power of 2)
+#ifndef FS_LOG_BUFFER_SIZE
+#  define FS_LOG_BUFFER_SIZE 64
+#endif
+
+// Deferred logging: max number of arguments of a message
+#ifndef FS_LOG_DEFERRED_ARGS
+#  define FS_LOG_DEFERRED_ARGS 6
+#endif
+
+// Deferred logging: space for the copies of the %s arguments of a message
+#ifndef FS_LOG_DEFERRED_TEXT
+#  define FS_LOG_DEFERRED_TEXT 64
+#endif
+
+// FileSystemSD: number of blocks of the read cache which is shared by all
+// open files (0 = no cache)
+#ifndef FS_SD_CACHE_BLOCKS
+#  define FS_SD_CACHE_BLOCKS 8
+#endif
+
+// FileSystemSD: size of the cached blocks (a multiple of the sector size)
+#ifndef FS_SD_CACHE_BLOCK_SIZE
+#  define FS_SD_CACHE_BLOCK_SIZE 512
+#endif
+
+// FileSystemSD: size of the write buffer of each open file: small writes are
+// collected and written in aligned chunks of this size (0 = no buffer)
+#ifndef FS_SD_WRITE_BUFFER_SIZE
+#  define FS_SD_WRITE_BUFFER_SIZE 512
+#endif
+
+// FileSystemSD: buffered data is written by the next write after this time
+// in ms (0 = only when the buffer is full, on fsync() and close())
+#ifndef FS_SD_WRITE_FLUSH_MS
+#  define FS_SD_WRITE_FLUSH_MS 1000
+#endif
+
+// FileSystemSD: number of paths for which the result of stat() is cached
+// (0 = no cache)
+#ifndef FS_SD_STAT_CACHE_SIZE
+#  define FS_SD_STAT_CACHE_SIZE 16
+#endif
+
+// FileSystemSD: number of directories for which the names of all entries are
+// kept in RAM (0 = readdir() reads each entry from the SD)
+#ifndef FS_SD_DIR_CACHE_SIZE
+#  define FS_SD_DIR_CACHE_SIZE 2
+#endif
+
+// Collect the I/O statistics of each file system (see FileSystemStats)
+#ifndef FS_STATS_ACTIVE
+#  define FS_STATS_ACTIVE 0
+#endif
+
+// Number of log2 buckets of the latency histograms: the last bucket counts
+// all calls from 2^(FS_STATS_BUCKETS-2) us
+#ifndef FS_STATS_BUCKETS
+#  define FS_STATS_BUCKETS 16
+#endif
+
 // Common Functionaliry
 #include "ConfigFS/fs_common.h"
 
@@ -7,6 +7,9 @@ extern "C" {
 #endif
 
 void *mem_map(const char *path, size_t *p_size);
+/// Provides the next max bytes of the file w/o copying: the buffer is only
+/// used by file systems which need to copy the data
+ssize_t read_view(int fd, size_t max, const void **p_data, void *buffer);
 
 #ifdef __cplusplus
 }
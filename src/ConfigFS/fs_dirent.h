@@ -18,6 +18,9 @@ extern "C" {
 DIR *opendir(const char *name);
 int closedir(DIR *dirp);
 struct dirent *readdir(DIR *dirp);
+void rewinddir(DIR *dirp);
+void seekdir(DIR *dirp, long loc);
+long telldir(DIR *dirp);
 int unlink(const char *pathname);
 
 #ifdef __cplusplus
@@ -25,6 +25,8 @@ int fstat(int file, struct stat *st);
 int read(int file, void *ptr, size_t len);
 int write(int file, const void *ptr, size_t len);
 off_t lseek(int fd, off_t offset, int mode);
+int fsync(int file);
+int unlink(const char *pathname);
 
 
 #ifdef FS_USE_F_INTERNAL
@@ -35,6 +37,7 @@ char *fgets_i(char *buffer, int size, FILE *stream);
 int fclose_i(FILE *fp);
 int fseek_i(FILE *stream, long int offset, int whence);
 int fgetc_i(FILE *stream);
+int setvbuf_i(FILE *stream, char *buffer, int mode, size_t size);
 #endif
 
 #ifdef __cplusplus
@@ -48,4 +51,5 @@ int fgetc_i(FILE *stream);
 #  define fclose fclose_i
 #  define fgetc fgetc_i
 #  define fseek fseek_i
+#  define setvbuf setvbuf_i
 #endif
@@ -2,52 +2,204 @@
 #ifdef FS_USE_F_INTERNAL
 
 #include "stdlib.h"
+#include "string.h"
+
+/// Buffered file which is provided as FILE* by fopen_i
+struct FILE_I {
+  int fd = -1;
+  /// read buffer: allocated at the first read if not provided by setvbuf
+  char *buffer = nullptr;
+  size_t buffer_size = FS_FILE_BUFFER_SIZE;
+  bool buffer_owned = false;
+  /// actual read position in the buffer
+  size_t pos = 0;
+  /// number of valid bytes in the buffer
+  size_t len = 0;
+  /// file offset of buffer[0]: -1 if unknown
+  long buffer_offset = 0;
+};
+
+static FILE_I *file_i(FILE *fp) { return (FILE_I *)fp; }
+
+// Refills the buffer: returns the number of available bytes
+static size_t refill(FILE_I *fi) {
+  if (fi->pos < fi->len) {
+    return fi->len - fi->pos;
+  }
+  if (fi->buffer_offset >= 0) {
+    fi->buffer_offset += fi->len;
+  }
+  fi->pos = 0;
+  fi->len = 0;
+  if (fi->buffer_size == 0) {
+    return 0;
+  }
+  if (fi->buffer == nullptr) {
+    fi->buffer = (char *)malloc(fi->buffer_size);
+    if (fi->buffer == nullptr) {
+      fi->buffer_size = 0;
+      return 0;
+    }
+    fi->buffer_owned = true;
+  }
+  int n = read(fi->fd, fi->buffer, fi->buffer_size);
+  fi->len = n > 0 ? n : 0;
+  return fi->len;
+}
 
 // C++ file operations are mapped to _i methods with the help of defines
 FILE *fopen_i(const char *path, const char *mode) {
   int file = open(path, 0);
   if (file < 0)
     return nullptr;
-  FILE *fp = (FILE *)malloc(sizeof(FILE));
-  fp->_file = file;
-  return fp;
+  FILE_I *fi = new FILE_I();
+  fi->fd = file;
+  return (FILE *)fi;
+}
+
+int setvbuf_i(FILE *stream, char *buffer, int mode, size_t size) {
+  FILE_I *fi = file_i(stream);
+  // only possible before any data has been buffered
+  if (fi->len > 0) {
+    return -1;
+  }
+  if (fi->buffer_owned) {
+    free(fi->buffer);
+  }
+  fi->buffer = mode == _IONBF ? nullptr : buffer;
+  fi->buffer_owned = false;
+  fi->buffer_size = mode == _IONBF ? 0 : size;
+  return 0;
 }
 
 size_t fread_i(void *buffer, size_t size, size_t count, FILE *stream) {
-  return read(stream->_file, buffer, size * count);
+  FILE_I *fi = file_i(stream);
+  size_t total = size * count;
+  if (total == 0) {
+    return 0;
+  }
+  char *out = (char *)buffer;
+  size_t result = 0;
+  while (result < total) {
+    size_t missing = total - result;
+    // big reads bypass the empty buffer
+    if (fi->pos >= fi->len && missing >= fi->buffer_size) {
+      if (fi->buffer_offset >= 0) {
+        fi->buffer_offset += fi->len;
+      }
+      fi->pos = fi->len = 0;
+      int n = read(fi->fd, out + result, missing);
+      if (n <= 0) {
+        break;
+      }
+      if (fi->buffer_offset >= 0) {
+        fi->buffer_offset += n;
+      }
+      result += n;
+      continue;
+    }
+    size_t available = refill(fi);
+    if (available == 0) {
+      break;
+    }
+    size_t n = missing < available ? missing : available;
+    memcpy(out + result, fi->buffer + fi->pos, n);
+    fi->pos += n;
+    result += n;
+  }
+  return result / size;
 }
 
 // Reads a single charac
 int fgetc_i(FILE *stream) {
-  char c;
+  FILE_I *fi = file_i(stream);
+  if (fi->pos < fi->len) {
+    return (unsigned char)fi->buffer[fi->pos++];
+  }
+  unsigned char c;
   size_t len = fread_i(&c, 1, 1, stream);
   return len == 1 ? c : -1;
 }
 
 char *fgets_i(char *s, int n, FILE *f) {
+  FILE_I *fi = file_i(f);
+  if (n <= 0) {
+    return nullptr;
+  }
   int count = 0;
-  int c = -1;
-  for (int j = 0; j < n - 1; j++) {
-    c = fgetc_i(f);
-    if (c < 0) {
+  while (count < n - 1) {
+    if (fi->buffer_size == 0) {
+      // unbuffered
+      int c = fgetc_i(f);
+      if (c < 0) {
+        break;
+      }
+      s[count++] = c;
+      if (c == '\n') {
+        break;
+      }
+      continue;
+    }
+    size_t available = refill(fi);
+    if (available == 0) {
       break;
     }
-    count = j;
-    s[count] = c;
-    if (c == '\n') {
+    size_t max = n - 1 - count;
+    size_t len = available < max ? available : max;
+    const char *start = fi->buffer + fi->pos;
+    const char *nl = (const char *)memchr(start, '\n', len);
+    if (nl != nullptr) {
+      len = nl - start + 1;
+    }
+    memcpy(s + count, start, len);
+    fi->pos += len;
+    count += len;
+    if (nl != nullptr) {
       break;
     }
   }
-  s[count + 1] = 0;
-  return c != -1 ? s : nullptr;
+  s[count] = 0;
+  return count > 0 ? s : nullptr;
 }
 
-int fclose_i(FILE *fp) { 
-  return close(fp->_file); 
+int fclose_i(FILE *fp) {
+  FILE_I *fi = file_i(fp);
+  int result = close(fi->fd);
+  if (fi->buffer_owned) {
+    free(fi->buffer);
+  }
+  delete fi;
+  return result;
 }
 
 int fseek_i(FILE *fp, long int offset, int whence) {
-  return lseek(fp->_file, offset, whence);
+  FILE_I *fi = file_i(fp);
+  // target offset: -1 if unknown
+  long target = -1;
+  if (whence == SEEK_SET) {
+    target = offset;
+  } else if (whence == SEEK_CUR && fi->buffer_offset >= 0) {
+    target = fi->buffer_offset + fi->pos + offset;
+  }
+  // seek within the buffer
+  if (target >= 0 && fi->buffer_offset >= 0 && target >= fi->buffer_offset &&
+      target <= fi->buffer_offset + (long)fi->len) {
+    fi->pos = target - fi->buffer_offset;
+    return 0;
+  }
+  // the fd is positioned at the end of the buffer
+  if (whence == SEEK_CUR) {
+    offset -= fi->len - fi->pos;
+  }
+  fi->pos = fi->len = 0;
+  // the file system might limit the position (e.g. to the end of the file)
+  off_t pos = lseek(fi->fd, offset, whence);
+  if (pos < 0) {
+    fi->buffer_offset = -1;
+    return -1;
+  }
+  fi->buffer_offset = pos;
+  return 0;
 }
 
 #endif
@@ -40,7 +40,7 @@ public:
 
   int close() { return p_fs->close(fd); }
 
-  int sync() { return 0; }
+  int sync() { return p_fs->fsync(fd); }
 
   int isatty() { return 0; }
 
@@ -191,7 +191,7 @@ public:
 
   int statvfs(const char *path, struct statvfs *buf) {
     FS_TRACEI();
-    if (Str(path).startsWith(name) && buf != nullptr) {
+    if (PathView(path).startsWith(name) && buf != nullptr) {
       *buf = statvfs_v;
       return 0;
     } else {
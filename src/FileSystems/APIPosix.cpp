@@ -2,6 +2,7 @@
 
 #if POSIX_C_METHOD_IMPLEMENTATION
 #include "FileSystems/Registry.h"
+#include <errno.h>
 #include <stdio.h>
 
 // To prevent linker errors in STM32
@@ -9,63 +10,131 @@ extern "C" int _unlink(const char *);
 extern "C" int _stat(const char *pathname, struct stat *statbuf);
 extern "C" int _open(const char *name, int flags, int mode);
 
+using namespace file_systems;
+
 void *mem_map(const char *path, size_t *p_size) {
   return file_systems::Registry::DefaultRegistry().fileSystemByName("FileSystemMemory")
       .mem_map(path, p_size);
 }
 
 int open(const char *name, int flags, ...) {
-  return file_systems::Registry::DefaultRegistry().fileSystem(name).open(name, flags, 0);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(name);
+  FS_STATS_START();
+  int result = fs.open(name, flags, 0);
+  FS_STATS_RECORD(fs, FSOpOpen, result);
+  return result;
 }
 
 int close(int file) {
   if (file<0) return file;
-  return file_systems::Registry::DefaultRegistry().fileSystem(file).close(file);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(file);
+  FS_STATS_START();
+  int result = fs.close(file);
+  FS_STATS_RECORD(fs, FSOpClose, result);
+  return result;
 }
 
 int fstat(int file, struct stat *statbuf) {
   if (file<0) return file;
-  return file_systems::Registry::DefaultRegistry().fileSystem(file).fstat(file, statbuf);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(file);
+  FS_STATS_START();
+  int result = fs.fstat(file, statbuf);
+  FS_STATS_RECORD(fs, FSOpStat, result);
+  return result;
 }
 
 int stat(const char *pathname, struct stat *statbuf) {
-  return file_systems::Registry::DefaultRegistry().fileSystem(pathname).stat(pathname,
-                                                                 statbuf);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(pathname);
+  FS_STATS_START();
+  int result = fs.stat(pathname, statbuf);
+  FS_STATS_RECORD(fs, FSOpStat, result);
+  return result;
 }
 
 int read(int file, void *ptr, size_t len) {
   if (file<0) return file;
-  return file_systems::Registry::DefaultRegistry().fileSystem(file).read(file, ptr, len);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(file);
+  FS_STATS_START();
+  int result = fs.read(file, ptr, len);
+  FS_STATS_RECORD(fs, FSOpRead, result);
+  return result;
+}
+
+ssize_t read_view(int file, size_t max, const void **p_data, void *buffer) {
+  if (file<0) return file;
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(file);
+  FS_STATS_START();
+  ssize_t result = fs.read_view(file, max, p_data, buffer);
+  FS_STATS_RECORD(fs, FSOpRead, result);
+  return result;
 }
 
 int write(int file, const void *ptr, size_t len) {
   if (file<0) return file;
-  return file_systems::Registry::DefaultRegistry().fileSystem(file).write(file, ptr, len);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(file);
+  FS_STATS_START();
+  int result = fs.write(file, ptr, len);
+  FS_STATS_RECORD(fs, FSOpWrite, result);
+  return result;
 }
 
 off_t lseek(int file, off_t offset, int mode) {
   if (file<0) return file;
-  return file_systems::Registry::DefaultRegistry().fileSystem(file).lseek(file, offset, mode);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(file);
+  FS_STATS_START();
+  off_t result = fs.lseek(file, offset, mode);
+  FS_STATS_RECORD(fs, FSOpLseek, result);
+  return result;
+}
+
+int fsync(int file) {
+  if (file<0) return file;
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(file);
+  FS_STATS_START();
+  int result = fs.fsync(file);
+  FS_STATS_RECORD(fs, FSOpFsync, result);
+  return result;
 }
 
 DIR *opendir(const char *name) {
-  return file_systems::Registry::DefaultRegistry().fileSystem(name).opendir(name);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(name);
+  FS_STATS_START();
+  DIR *result = fs.opendir(name);
+  FS_STATS_RECORD(fs, FSOpOpendir, result == nullptr ? -1 : 0);
+  return result;
 }
 
 int closedir(DIR *dirp) {
-  file_systems::FileSystemBase *pfs =
-      static_cast<file_systems::DIR_BASE *>(dirp)->p_file_system;
+  FileSystemBase *pfs = static_cast<DIR_BASE *>(dirp)->p_file_system;
   return pfs->closedir(dirp);
 }
 
+// the end of the directory is not counted as error: only a result w/o entry
+// which sets errno (e.g. EBADF for an invalid DIR)
 struct dirent *readdir(DIR *dirp) {
-  file_systems::FileSystemBase *pfs =
-      static_cast<file_systems::DIR_BASE *>(dirp)->p_file_system;
-  return pfs->readdir(dirp);
+  FileSystemBase *pfs = static_cast<DIR_BASE *>(dirp)->p_file_system;
+  FS_STATS_START();
+  int old_errno = errno;
+  errno = 0;
+  struct dirent *result = pfs->readdir(dirp);
+  bool is_error = result == nullptr && errno != 0;
+  FS_STATS_RECORD(*pfs, FSOpReaddir, is_error ? -1 : 0);
+  if (!is_error) errno = old_errno;
+  return result;
 }
 
+void rewinddir(DIR *dirp) { static_cast<DIR_BASE *>(dirp)->seek(0); }
+
+void seekdir(DIR *dirp, long loc) { static_cast<DIR_BASE *>(dirp)->seek(loc); }
+
+long telldir(DIR *dirp) { return static_cast<DIR_BASE *>(dirp)->tell(); }
+
 int unlink(const char *pathname) {
-  return file_systems::Registry::DefaultRegistry().fileSystem(pathname).unlink(pathname);
+  FileSystemBase &fs = Registry::DefaultRegistry().fileSystem(pathname);
+  FS_STATS_START();
+  int result = fs.unlink(pathname);
+  FS_STATS_RECORD(fs, FSOpUnlink, result);
+  return result;
 }
 
 
@@ -0,0 +1,145 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "Collections/IntrusiveList.h"
+
+namespace file_systems {
+
+/**
+ * @brief Cached block of a file
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct CacheBlock : public IntrusiveListNode<CacheBlock> {
+  /// id of the file: 0 if the block is not used
+  uint32_t file_id = 0;
+  /// block number in the file
+  uint32_t block_no = 0;
+  /// number of valid bytes: less then the block size at the end of the file
+  size_t len = 0;
+  uint8_t *data = nullptr;
+};
+
+/**
+ * @brief LRU cache of sector aligned file blocks which is shared by all open
+ * files: a block is identified by the file id and the block number. The
+ * blocks only hold data which was read, so they can be dropped at any time.
+ * The lookup is a linear search in LRU order, which is fast for the few
+ * blocks that fit into the RAM of a microcontroller.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BlockCache {
+public:
+  BlockCache() = default;
+  BlockCache(const BlockCache &) = delete;
+  BlockCache &operator=(const BlockCache &) = delete;
+  ~BlockCache() { end(); }
+
+  /// Allocates count blocks of blockSize bytes: 0 deactivates the cache
+  bool begin(int count, size_t blockSize) {
+    end();
+    if (count <= 0 || blockSize == 0) return true;
+    p_blocks = new CacheBlock[count];
+    p_data = new uint8_t[count * blockSize];
+    if (p_blocks == nullptr || p_data == nullptr) {
+      end();
+      return false;
+    }
+    block_size = blockSize;
+    block_count = count;
+    for (int j = 0; j < count; j++) {
+      p_blocks[j].data = p_data + j * blockSize;
+      lru.push_back(p_blocks[j]);
+    }
+    return true;
+  }
+
+  /// Releases the memory
+  void end() {
+    lru.clear();
+    delete[] p_blocks;
+    delete[] p_data;
+    p_blocks = nullptr;
+    p_data = nullptr;
+    block_count = 0;
+  }
+
+  bool isActive() { return block_count > 0; }
+
+  size_t blockSize() { return block_size; }
+
+  /// Number of blocks
+  int size() { return block_count; }
+
+  /// Provides the cached block (which becomes the most recently used one) or
+  /// nullptr
+  CacheBlock *find(uint32_t fileId, uint32_t blockNo) {
+    for (auto &block : lru) {
+      // unused blocks are at the end
+      if (block.file_id == 0) break;
+      if (block.file_id == fileId && block.block_no == blockNo) {
+        lru.moveToFront(block);
+        hit_count++;
+        return &block;
+      }
+    }
+    miss_count++;
+    return nullptr;
+  }
+
+  /// Reuses the least recently used block for the indicated file block: the
+  /// caller needs to fill in the data and len
+  CacheBlock *allocate(uint32_t fileId, uint32_t blockNo) {
+    CacheBlock *p_block = lru.back();
+    if (p_block == nullptr) return nullptr;
+    lru.moveToFront(*p_block);
+    p_block->file_id = fileId;
+    p_block->block_no = blockNo;
+    p_block->len = 0;
+    return p_block;
+  }
+
+  /// Drops the block (e.g. because it could not be filled)
+  void release(CacheBlock &block) {
+    block.file_id = 0;
+    lru.remove(block);
+    lru.push_back(block);
+  }
+
+  /// Drops the blocks from - to (inclusive) of the file
+  void invalidate(uint32_t fileId, uint32_t from = 0,
+                  uint32_t to = UINT32_MAX) {
+    for (int j = 0; j < block_count; j++) {
+      CacheBlock &block = p_blocks[j];
+      if (block.file_id == fileId && block.block_no >= from &&
+          block.block_no <= to) {
+        release(block);
+      }
+    }
+  }
+
+  /// Drops all blocks
+  void clear() {
+    for (int j = 0; j < block_count; j++) {
+      if (p_blocks[j].file_id != 0) release(p_blocks[j]);
+    }
+  }
+
+  /// Number of find() calls which provided a block
+  uint32_t hits() { return hit_count; }
+
+  /// Number of find() calls which did not find the block
+  uint32_t misses() { return miss_count; }
+
+protected:
+  IntrusiveList<CacheBlock> lru;
+  CacheBlock *p_blocks = nullptr;
+  uint8_t *p_data = nullptr;
+  size_t block_size = 0;
+  int block_count = 0;
+  uint32_t hit_count = 0;
+  uint32_t miss_count = 0;
+};
+
+} // namespace file_systems
@@ -0,0 +1,191 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Collections/IntrusiveList.h"
+#include "Collections/Vector.h"
+
+namespace file_systems {
+
+/**
+ * @brief Entry of a DirListing: the name is stored in the names of the listing
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct DirItem {
+  size_t name_pos = 0;
+  bool is_dir = false;
+};
+
+/**
+ * @brief Snapshot of the names and types of a directory. A listing does not
+ * change after it was added to the DirCache, so it can be read w/o lock by
+ * all DIRs which hold a reference.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct DirListing : public IntrusiveListNode<DirListing> {
+  DirListing(const char *dirPath) { path = strdup(dirPath); }
+  ~DirListing() { free(path); }
+  /// copy of the directory path
+  char *path = nullptr;
+  /// number of open DIRs which use the listing
+  int ref_count = 0;
+  /// false when the listing was dropped from the cache: it is deleted by the
+  /// last release
+  bool cached = false;
+
+  /// Adds an entry: returns false if there is not enough memory
+  bool add(const char *name, bool isDir) {
+    DirItem item;
+    item.name_pos = names.size();
+    item.is_dir = isDir;
+    size_t len = strlen(name) + 1;
+    if (!names.resize(item.name_pos + len)) return false;
+    memcpy(names.data() + item.name_pos, name, len);
+    return items.push_back(item);
+  }
+
+  /// Number of entries
+  int size() { return items.size(); }
+
+  const char *name(int idx) { return names.data() + items[idx].name_pos; }
+
+  bool isDirectory(int idx) { return items[idx].is_dir; }
+
+protected:
+  Vector<char> names;
+  Vector<DirItem> items;
+};
+
+/**
+ * @brief Bounded LRU cache of directory listings: the owner needs to
+ * invalidate the directories which are changed. Listings which are dropped
+ * while they are still used by an open DIR stay valid until the DIR releases
+ * them. Paths are compared w/o trailing /.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class DirCache {
+public:
+  DirCache() = default;
+  DirCache(const DirCache &) = delete;
+  DirCache &operator=(const DirCache &) = delete;
+  ~DirCache() { end(); }
+
+  /// Defines the max number of cached listings: 0 deactivates the cache
+  bool begin(int count) {
+    end();
+    max_count = count < 0 ? 0 : count;
+    return true;
+  }
+
+  /// Drops all listings
+  void end() {
+    clear();
+    max_count = 0;
+  }
+
+  bool isActive() { return max_count > 0; }
+
+  /// Provides the listing of the path with an additional reference (see
+  /// release()) or nullptr
+  DirListing *get(const char *path) {
+    DirListing *p_listing = find(path, keyLen(path));
+    if (p_listing == nullptr) {
+      miss_count++;
+      return nullptr;
+    }
+    lru.moveToFront(*p_listing);
+    p_listing->ref_count++;
+    hit_count++;
+    return p_listing;
+  }
+
+  /// Number of changes: a listing which was read while the number changed
+  /// might be outdated
+  uint32_t version() { return change_count; }
+
+  /// Adds a listing which was read at the indicated version and assigns a
+  /// reference: outdated listings are not cached and deleted by the release
+  void put(DirListing *p_listing, uint32_t version) {
+    p_listing->ref_count++;
+    const char *path = p_listing->path;
+    if (!isActive() || version != change_count || path == nullptr) return;
+    DirListing *p_old = find(path, keyLen(path));
+    if (p_old != nullptr) drop(*p_old);
+    while (count >= max_count) drop(*lru.back());
+    p_listing->cached = true;
+    lru.push_front(*p_listing);
+    count++;
+  }
+
+  /// Releases a reference: a listing which is not cached any more is deleted
+  void release(DirListing *p_listing) {
+    if (p_listing == nullptr) return;
+    p_listing->ref_count--;
+    if (p_listing->ref_count <= 0 && !p_listing->cached) delete p_listing;
+  }
+
+  /// Drops the listing of the directory
+  void invalidate(const char *path) { invalidate(path, keyLen(path)); }
+
+  /// Drops the listing of the directory which contains the path
+  void invalidateParent(const char *path) {
+    size_t len = keyLen(path);
+    while (len > 0 && path[len - 1] != '/') len--;
+    // keep the / of the root
+    invalidate(path, len > 1 ? len - 1 : len);
+  }
+
+  /// Drops all listings
+  void clear() {
+    change_count++;
+    while (!lru.empty()) drop(*lru.front());
+  }
+
+  /// Number of get() calls which found the listing
+  uint32_t hits() { return hit_count; }
+
+  /// Number of get() calls which did not find the listing
+  uint32_t misses() { return miss_count; }
+
+protected:
+  IntrusiveList<DirListing> lru;
+  int count = 0;
+  int max_count = 0;
+  uint32_t change_count = 0;
+  uint32_t hit_count = 0;
+  uint32_t miss_count = 0;
+
+  // length of the path w/o trailing /
+  static size_t keyLen(const char *path) {
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') len--;
+    return len;
+  }
+
+  DirListing *find(const char *path, size_t len) {
+    for (auto &listing : lru) {
+      if (keyLen(listing.path) == len && strncmp(listing.path, path, len) == 0)
+        return &listing;
+    }
+    return nullptr;
+  }
+
+  void invalidate(const char *path, size_t len) {
+    change_count++;
+    DirListing *p_listing = find(path, len);
+    if (p_listing != nullptr) drop(*p_listing);
+  }
+
+  void drop(DirListing &listing) {
+    lru.remove(listing);
+    count--;
+    listing.cached = false;
+    if (listing.ref_count <= 0) delete &listing;
+  }
+};
+
+} // namespace file_systems
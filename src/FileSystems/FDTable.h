@@ -0,0 +1,74 @@
+#pragma once
+#include "ConfigFS.h"
+#include "FileSystems/Mutex.h"
+
+namespace file_systems {
+
+struct RegEntry;
+
+/**
+ * @brief Table of the open files by file descriptor. The table is split into
+ * segments which are allocated on demand and never moved, so that an entry
+ * can be read w/o any lock while other tasks are opening or closing files.
+ * Updates must be serialized by the caller.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FDTable {
+public:
+  FDTable() = default;
+  FDTable(const FDTable &) = delete;
+  FDTable &operator=(const FDTable &) = delete;
+
+  ~FDTable() {
+    for (int j = 0; j < FS_FD_SEGMENTS; j++) {
+      delete[] segments[j].load();
+    }
+  }
+
+  /// Provides the entry for the fd or nullptr: lock free
+  RegEntry *get(int fd) {
+    if (fd < 0 || fd >= capacity()) {
+      return nullptr;
+    }
+    Slot *segment = segments[fd / FS_FD_SEGMENT_SIZE].load();
+    if (segment == nullptr) {
+      return nullptr;
+    }
+    return segment[fd % FS_FD_SEGMENT_SIZE].load();
+  }
+
+  /// Publishes the entry for the fd: allocates the segment if necessary
+  bool set(int fd, RegEntry *entry) {
+    if (fd < 0 || fd >= capacity()) {
+      return false;
+    }
+    int segment_idx = fd / FS_FD_SEGMENT_SIZE;
+    Slot *segment = segments[segment_idx].load();
+    if (segment == nullptr) {
+      segment = new Slot[FS_FD_SEGMENT_SIZE];
+      if (segment == nullptr) {
+        return false;
+      }
+      segments[segment_idx].store(segment);
+    }
+    segment[fd % FS_FD_SEGMENT_SIZE].store(entry);
+    if (fd >= len) {
+      len = fd + 1;
+    }
+    return true;
+  }
+
+  /// Number of used slots (including the closed ones)
+  int size() { return len; }
+
+  /// Max number of file descriptors
+  int capacity() { return FS_FD_SEGMENTS * FS_FD_SEGMENT_SIZE; }
+
+protected:
+  typedef AtomicPtr<RegEntry> Slot;
+  AtomicPtr<Slot> segments[FS_FD_SEGMENTS];
+  int len = 0;
+};
+
+} // namespace file_systems
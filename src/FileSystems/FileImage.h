@@ -0,0 +1,102 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// On AVR the generated data is in PROGMEM, which can not be accessed with a
+// regular pointer: the FileSystemMemory copies it with memcpy_P
+#ifdef ARDUINO_ARCH_AVR
+#  include <avr/pgmspace.h>
+#  define FS_IMAGE_PROGMEM 1
+#else
+#  define FS_IMAGE_PROGMEM 0
+#endif
+
+namespace file_systems {
+
+/**
+ * @brief A file of a FileImage: the name is relative to the mount point
+ * (w/o leading /) and the offset is relative to the FileImage data
+ */
+struct ImageEntry {
+  const char *name;
+  uint32_t offset;
+  uint32_t size;
+};
+
+/**
+ * @brief Files which were packed at build time by fs-image into a generated
+ * header: the entries are sorted by name (strcmp order) and the data of all
+ * files is stored in one contiguous array, so everything can stay in flash
+ * and a lookup is a binary search.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct FileImage {
+  const ImageEntry *entries;
+  size_t count;
+  const uint8_t *data;
+
+  /// Finds the file by name: returns nullptr if it does not exist
+  const ImageEntry *find(const char *name) const {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+      size_t mid = (low + high) / 2;
+      int cmp = strcmp(entries[mid].name, name);
+      if (cmp == 0) return &entries[mid];
+      if (cmp < 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return nullptr;
+  }
+
+  /// Index of the first file in the directory: the files of a directory are
+  /// stored one after the other
+  size_t dirStart(const char *dir) const { return dirStart(dir, strlen(dir)); }
+
+  /// Index of the first file in the directory with the first len characters
+  /// of dir
+  size_t dirStart(const char *dir, size_t len) const {
+    return len == 0 ? 0 : search(dir, len, false);
+  }
+
+  /// Index after the last file in the directory (and its subdirectories)
+  size_t dirEnd(const char *dir, size_t len) const {
+    return len == 0 ? count : search(dir, len, true);
+  }
+
+  /// Checks if the directory with the first len characters of dir exists
+  bool isDir(const char *dir, size_t len) const {
+    return dirStart(dir, len) < dirEnd(dir, len);
+  }
+
+protected:
+  // binary search for the first entry which is >= (or > if after) "dir/"
+  size_t search(const char *dir, size_t len, bool after) const {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+      size_t mid = (low + high) / 2;
+      int cmp = compareDir(entries[mid].name, dir, len);
+      if (cmp < 0 || (after && cmp == 0)) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  }
+
+  // compares the name with the prefix "dir/": 0 if the name starts with it
+  static int compareDir(const char *name, const char *dir, size_t len) {
+    int cmp = strncmp(name, dir, len);
+    if (cmp != 0) return cmp;
+    return (int)(uint8_t)name[len] - '/';
+  }
+};
+
+} // namespace file_systems
@@ -1,5 +1,7 @@
 #pragma once
-#include "Collections/Str.h"
+#include "Collections/PathView.h"
+#include "LoggerFS.h"
+#include "FileSystems/FileSystemStats.h"
 
 namespace file_systems {
 
@@ -21,7 +23,7 @@ public:
   virtual const char *pathPrefix() { return path_prefix; }
   /// Checks if the file is managed by this file system
   virtual bool isValidFile(const char *path) {
-    return (Str(path).startsWith(pathPrefix()));
+    return PathView(path).startsWith(pathPrefix());
   }
 
   operator bool() { return path_prefix != nullptr; }
@@ -34,7 +36,22 @@ public:
   }
   virtual ssize_t write(int fd, const void *data, size_t size) { return 0; }
   virtual ssize_t read(int fd, void *data, size_t size) { return 0; }
+  /// Provides a pointer to the next max bytes w/o copying and advances the
+  /// position. File systems which can not provide the data in place copy it
+  /// into the buffer.
+  virtual ssize_t read_view(int fd, size_t max, const void **p_data,
+                            void *buffer) {
+    if (buffer == nullptr) {
+      FS_LOGE("read_view not supported w/o buffer");
+      return -1;
+    }
+    ssize_t len = read(fd, buffer, max);
+    *p_data = buffer;
+    return len;
+  }
   virtual int close(int fd) { return -1; };
+  /// writes the buffered data of the file
+  virtual int fsync(int fd) { return 0; }
   virtual int fstat(int fd, struct stat *st) { return -1; };
   virtual int stat(const char *pathname, struct stat *statbuf) { return -1; };
   virtual off_t lseek(int fd, off_t offset, int mode) { return -1; };
@@ -48,6 +65,11 @@ public:
   // method for memory file to get the data content
   virtual void *mem_map(const char *path, size_t *p_size) { return NULL; }
 
+#if FS_STATS_ACTIVE
+  /// I/O statistics of the calls via the posix API
+  FileSystemStats &stats() { return io_stats; }
+#endif
+
   /// file name w/o leading /
   static const char *standardName(const char *name) {
     return name[0] == '/' ? name + 1 : name;
@@ -59,6 +81,9 @@ protected:
 #ifdef ESP32
   esp_vfs_t myfs;
 #endif
+#if FS_STATS_ACTIVE
+  FileSystemStats io_stats;
+#endif
 
   /// The ESP32 is removing the path prefix for all file processing
   virtual int filenameOffset() { return filename_offset; }
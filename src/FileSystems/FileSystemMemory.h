@@ -1,9 +1,15 @@
 #pragma once
+#include "Collections/ChunkedBuffer.h"
+#include "Collections/DirTree.h"
+#include "Collections/HashIndex.h"
+#include "Compression/CompressedBlocks.h"
 #include "ConfigFS.h"
 #include "FileSystems/APIMbed.h"
+#include "FileSystems/FileImage.h"
 #include "FileSystems/Registry.h"
 #include "LoggerFS.h"
 #include "stdint.h"
+#include <errno.h>
 
 #define MAGIC_DIR_EXT 12345679
 #define FS_NAME_MEM "FileSystemMemory"
@@ -16,34 +22,97 @@ namespace file_systems {
 struct DIR_EXT : public DIR_BASE {
   DIR_EXT() { magic_id = MAGIC_DIR_EXT; }
   const char *dir;
+  /// length of dir w/o trailing /
+  size_t dir_len = 0;
   /// dirent related to this DIR
   dirent actual_dirent;
-  /// all unprocessed files: only used by FileSystemMemory!
-  Vector<RegEntry *> files;
+  /// directory in the tree: nullptr if it only exists in the mounted images
+  DirNode<RegEntry> *p_node = nullptr;
+  /// next child of p_node which will be returned
+  DirNode<RegEntry> *p_next = nullptr;
+  /// actual mounted image: the images are processed after the tree
+  int image_idx = 0;
+  /// next and end entry in the actual image
+  size_t image_pos = 0;
+  size_t image_end = 0;
+  bool image_started = false;
   int pos = 0;
+  /// mutex of the file system: seek and size read several entries
+  Mutex *p_mutex = nullptr;
+
+  /// restarts with the first entry
+  void rewind() {
+    p_next = p_node != nullptr ? p_node->first_child : nullptr;
+    image_idx = 0;
+    image_started = false;
+    pos = 0;
+  }
 
   virtual bool seek(off_t offset) {
-    if (offset < 0 || offset < size()) {
+    if (offset < 0) {
       return false;
     }
-    pos = offset;
+    LockGuard guard(*p_mutex);
+    rewind();
+    while (pos < offset) {
+      if (p_file_system->readdir(this) == nullptr) return false;
+    }
     return true;
   }
   virtual off_t tell() { return pos; }
-  virtual ssize_t size() { return files.size(); };
+  virtual ssize_t size() {
+    LockGuard guard(*p_mutex);
+    DIR_EXT tmp = *this;
+    tmp.rewind();
+    while (p_file_system->readdir(&tmp) != nullptr) {
+    }
+    return tmp.pos;
+  };
+};
+
+/**
+ * @brief Data of a writable in memory file which is shared by all open files
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct RamFile {
+  RamFile(ObjectPool<Chunk<FS_RAM_CHUNK_SIZE>> &pool) : buffer(pool) {}
+  ChunkedBuffer<FS_RAM_CHUNK_SIZE> buffer;
+  /// number of open files
+  int open_count = 0;
+  /// true if the file was unlinked while it was open
+  bool unlinked = false;
 };
 
 /**
- * @brief  In Memory File Content to refer to data stored e.g. in PROGMEM
+ * @brief  In Memory File Content to refer to data stored e.g. in PROGMEM or
+ * to a writable RamFile
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
 struct RegContentMemory : public RegContent {
   RegContentMemory() { id = ContentMemory; }
-  operator bool() { return data != nullptr; }
+  ~RegContentMemory() { delete[] p_block; }
+  operator bool() { return data != nullptr || p_ram != nullptr; }
   const uint8_t *data = nullptr;
   size_t size = 0;
   size_t current_pos = 0;
+  /// writable file or copy on write overlay over data: provides the content
+  RamFile *p_ram = nullptr;
+  /// flags provided by open
+  int flags = 0;
+  /// compressed file: size of the CompressedBlocks in data
+  size_t compressed_size = 0;
+  /// compressed file: decompressed block of the open file
+  uint8_t *p_block = nullptr;
+  /// compressed file: index of the block in p_block
+  int block_idx = -1;
+  /// data of a FileImage which needs to be copied with memcpy_P (AVR)
+  bool progmem = false;
+  /// true if data contains CompressedBlocks
+  bool isCompressed() { return compressed_size > 0; }
+  /// actual file size
+  size_t length() { return p_ram != nullptr ? p_ram->buffer.size() : size; }
 };
 
 /**
@@ -144,92 +213,200 @@ public:
   /// file is valid if it has been added
   bool isValidFile(const char *path) override {
     FS_TRACED();
-    for (RegEntry *entry : files) {
-      if (entry != nullptr && *entry) {
-        if (Str(entry->file_name).equals(path)) {
-          return true;
-        }
-      }
-    }
-    return false;
+    return getEntry(path);
   }
 
   /// adds a in memory file (updates existing entry if name already exists)
   bool add(const char *name, const void *data, size_t len) {
-    const char *name_internal = internalFileName(name, true);
-    FS_LOGI("add: name='%s' len=%d", name_internal, len);
-    if (&Registry::DefaultRegistry().fileSystem(name) != this) {
-      FS_LOGE("File %s not vaid for  %s in %s", name, this->pathPrefix(),
-              Registry::DefaultRegistry().fileSystem(name).name());
+    return addMemory(name, data, len, 0);
+  }
+
+  /// adds a compressed in memory file which was created by fs-pack: the data
+  /// is decompressed by block when it is read
+  bool addCompressed(const char *name, const void *data, size_t len) {
+    CompressedBlocks blocks((const uint8_t *)data, len);
+    if (!blocks) {
+      FS_LOGE("addCompressed: %s has no valid header", name);
       return false;
     }
-    // update existing entry if name already registered
-    RegEntry &existing = getEntry(name_internal);
-    if (existing) {
-      FS_LOGI("add: updating existing entry '%s'", name_internal);
-      RegContentMemory *content = static_cast<RegContentMemory *>(existing.content);
-      content->data = (uint8_t *)data;
-      content->size = len;
-      return true;
-    }
-    RegEntry *entry = new RegEntry();
-    entry->p_file_system = this;
-    // setup content
-    RegContentMemory *content = new RegContentMemory();
-    content->data = (uint8_t *)data;
-    content->size = len;
-    // setup entry
-    entry->file_name = strdup(name_internal);
-    entry->file_name_owned = true;
-    entry->content = content;
-    files.push_back(entry);
-    FS_LOGD("files: %d", files.size());
-    return true;
+    return addMemory(name, data, blocks.size(), len);
+  }
+
+  /// mounts the files of an image which was generated by fs-image: the files
+  /// are used in place w/o any allocation or processing per file
+  void mount(const FileImage &image) {
+    FS_LOGI("mount: %d files", (int)image.count);
+    LockGuard guard(mutex);
+    images.push_back(&image);
   }
+
   /// @brief  Determines the regentry by name
   RegEntry &get(const char *path) {
     return getEntry(internalFileName(path, api_files_with_prefix));
   }
 
   /// number of file entries
-  size_t size() { return files.size(); }
+  size_t size() {
+    LockGuard guard(mutex);
+    return files.size();
+  }
 
   /// Returns true if there are no files
   bool isEmpty() { return size() == 0; }
 
-  /// file operations
+  /// Defines the number of preallocated contents for open files: must be
+  /// called before any file is opened
+  bool setPoolSize(int size, bool heapFallback = true) {
+    LockGuard guard(mutex);
+    return content_pool.setCapacity(size, heapFallback);
+  }
+
+  /// Defines the number of preallocated blocks for writable files: must be
+  /// called before any data is written
+  bool setChunkPoolSize(int size, bool heapFallback = true) {
+    LockGuard guard(mutex);
+    return chunk_pool.setCapacity(size, heapFallback);
+  }
+
+  /// file operations: files which are created with O_CREAT are writable.
+  /// Opening a static file for writing creates a copy on write overlay.
   int open(const char *path, int flags, int mode) override {
     FS_LOGI("FileSystemMemory::open: path='%s' ", path);
-    RegEntry &mem_entry = get(path);
-    if (!mem_entry) {
-      FS_LOGW("open: file '%s' does not exist", path);
-      return -1;
+    bool is_write = (flags & O_ACCMODE) != O_RDONLY;
+    RegContentMemory *p_ref = nullptr;
+    RegContentMemory *p_new = nullptr;
+    RegContentMemory image_content;
+    {
+      LockGuard guard(mutex);
+      RegEntry &mem_entry = get(path);
+      const char *name_internal = internalFileName(path, api_files_with_prefix);
+      if (!mem_entry && getImageContent(name_internal, image_content)) {
+        if ((flags & O_CREAT) && (flags & O_EXCL)) {
+          FS_LOGW("open: file '%s' already exists", path);
+          errno = EEXIST;
+          return -1;
+        }
+        if (is_write && image_content.progmem) {
+          FS_LOGW("open: PROGMEM file '%s' is read only", path);
+          errno = EROFS;
+          return -1;
+        }
+        // a writable image file needs its own entry
+        p_ref = is_write ? addImageEntry(name_internal, image_content)
+                         : &image_content;
+        if (p_ref == nullptr) {
+          return -1;
+        }
+      } else if (!mem_entry) {
+        bool is_dir = isDir(PathView(name_internal));
+        if (!(flags & O_CREAT) || is_dir) {
+          FS_LOGW("open: file '%s' does not exist", path);
+          errno = is_dir ? EISDIR : ENOENT;
+          return -1;
+        }
+        p_ref = createRamFile(name_internal);
+        if (p_ref == nullptr) {
+          errno = ENOTDIR;
+          return -1;
+        }
+      } else if ((flags & O_CREAT) && (flags & O_EXCL)) {
+        FS_LOGW("open: file '%s' already exists", path);
+        errno = EEXIST;
+        return -1;
+      } else {
+        p_ref = (RegContentMemory *)mem_entry.content;
+      }
+      if (is_write && p_ref->isCompressed()) {
+        FS_LOGW("open: compressed file '%s' is read only", path);
+        errno = EROFS;
+        return -1;
+      }
+      if (is_write && p_ref->p_ram == nullptr) {
+        createOverlay(p_ref);
+      }
+      if (is_write && (flags & O_TRUNC)) {
+        p_ref->p_ram->buffer.truncate(0);
+      }
+      // copy content, so that we can release the entry.content when it is
+      // closed: the reference keeps the RamFile valid if it is unlinked
+      p_new = content_pool.create();
+      if (p_new == nullptr) {
+        FS_LOGW("open: no free content for %s", path);
+        return -1;
+      }
+      p_new->size = p_ref->size;
+      p_new->data = p_ref->data;
+      p_new->p_ram = p_ref->p_ram;
+      p_new->compressed_size = p_ref->compressed_size;
+      p_new->progmem = p_ref->progmem;
+      p_new->flags = flags;
+      p_new->current_pos = 0;
+      if (p_new->p_ram != nullptr) {
+        p_new->p_ram->open_count++;
+      }
     }
     RegEntry &entry = Registry::DefaultRegistry().openFile(path, *this);
     // make content available in open files
     if (&entry == &NoRegEntry) {
       FS_LOGW("open: entry invalid: %s", path);
+      releaseContent(p_new);
       return -1;
     }
-    RegContentMemory *p_ref = (RegContentMemory *)mem_entry.content;
-    // copy content, so that we can delete the entry.content when it is closed
-    RegContentMemory *p_new = new RegContentMemory();
-    p_new->size = p_ref->size;
-    p_new->data = p_ref->data;
-    p_new->current_pos = 0;
     entry.content = p_new;
     return entry.fileID;
   }
 
-  /// write: not suported
+  /// write: only supported for files which were created with O_CREAT
   ssize_t write(int fd, const void *data, size_t size) override {
-    FS_LOGW("Write not supported by file system");
-    return 0;
+    FS_LOGI("write: fd='%d' size=%d", fd, (int)size);
+    RegEntry &entry = Registry::DefaultRegistry().getEntry(fd);
+    RegContentMemory *p_memory = getContent(entry);
+    if (p_memory == nullptr || p_memory->p_ram == nullptr ||
+        (p_memory->flags & O_ACCMODE) == O_RDONLY) {
+      FS_LOGW("write: fd=%d is not writable", fd);
+      return -1;
+    }
+    LockGuard guard(mutex);
+    ChunkedBuffer<FS_RAM_CHUNK_SIZE> &buffer = p_memory->p_ram->buffer;
+    if (p_memory->flags & O_APPEND) {
+      p_memory->current_pos = buffer.size();
+    }
+    size_t len = buffer.write(p_memory->current_pos, data, size);
+    p_memory->current_pos += len;
+    if (len < size) {
+      FS_LOGW("write: only %d of %d bytes written", (int)len, (int)size);
+    }
+    return len;
   };
 
   ssize_t read(int fd, void *data, size_t size) override {
     FS_LOGI("read: fd='%d' size=%d", fd, (int)size);
-    if (size == 0) {
+    RegContentMemory *p_progmem =
+        getContent(Registry::DefaultRegistry().getEntry(fd));
+    if (p_progmem != nullptr && p_progmem->progmem) {
+      return readProgmem(p_progmem, data, size);
+    }
+    // writable files provide the data by chunk
+    size_t result = 0;
+    while (result < size) {
+      const void *p_data = nullptr;
+      ssize_t len = read_view(fd, size - result, &p_data, nullptr);
+      if (len <= 0) {
+        if (result == 0) return len;
+        break;
+      }
+      // Copy requested data
+      memmove((uint8_t *)data + result, p_data, len);
+      result += len;
+    }
+    return result;
+  }
+
+  /// provides the data w/o copying: the buffer is not used
+  ssize_t read_view(int fd, size_t max, const void **p_data,
+                    void *buffer) override {
+    FS_LOGI("read_view: fd='%d' size=%d", fd, (int)max);
+    if (max == 0) {
       return 0;
     }
     // If we did not find any content we return 0
@@ -241,17 +418,37 @@ public:
     }
     // If we are at the end we return 0
     size_t pos = p_memory->current_pos;
+    if (p_memory->p_ram != nullptr) {
+      // the data is only contiguous up to the end of the chunk
+      LockGuard guard(mutex);
+      const uint8_t *p_chunk_data = nullptr;
+      size_t len = p_memory->p_ram->buffer.view(pos, max, &p_chunk_data);
+      p_memory->current_pos += len;
+      *p_data = p_chunk_data;
+      FS_LOGD("=> read: pos=%d size=%d fd=%d -> %d", pos, (int)max, fd, len);
+      return len;
+    }
     if (pos >= p_memory->size) {
       FS_LOGD("=> read: pos=%d file-size=%d fd=%d -> %d", pos, p_memory->size,
               fd, 0);
       return 0;
     }
-    // Copy requested data
-    int size_min_pos = p_memory->size - pos;
-    int len = size<size_min_pos?size : size_min_pos;
+    if (p_memory->isCompressed()) {
+      return readCompressed(p_memory, max, p_data);
+    }
+    if (p_memory->progmem) {
+      if (buffer == nullptr) {
+        FS_LOGE("read_view: PROGMEM data needs a buffer");
+        return -1;
+      }
+      *p_data = buffer;
+      return readProgmem(p_memory, buffer, max);
+    }
+    size_t size_min_pos = p_memory->size - pos;
+    size_t len = max < size_min_pos ? max : size_min_pos;
     p_memory->current_pos += len;
-    memmove(data, p_memory->data + pos, len);
-    FS_LOGD("=> read: pos=%d size=%d fd=%d -> %d", pos, (int)size, fd, len);
+    *p_data = p_memory->data + pos;
+    FS_LOGD("=> read: pos=%d size=%d fd=%d -> %d", pos, (int)max, fd, len);
     return len;
   }
 
@@ -269,6 +466,12 @@ public:
 
   int close(int fd) override {
     FS_LOGI("close: fd='%d' ", fd);
+    RegEntry &entry = Registry::DefaultRegistry().getEntry(fd);
+    RegContentMemory *p_memory = getContent(entry);
+    if (p_memory != nullptr) {
+      entry.content = nullptr;
+      releaseContent(p_memory);
+    }
     Registry::DefaultRegistry().closeFile(fd);
     return 0;
   }
@@ -283,129 +486,223 @@ public:
     return statContent(false, entry.file_name, p_memory, st);
   }
 
+  /// files and directories are found with one lookup: if the path does not
+  /// exist we return -1 with errno ENOENT
   int stat(const char *path, struct stat *st) override {
     FS_LOGI("stat: path='%s' ", path);
-    // find file in registry
-    RegEntry &mem_entry = get(path);
-    // if not found it might be a directory
-    bool is_dir = false;
-    RegContentMemory *p_memory = nullptr;
-    if (!mem_entry) {
-      is_dir = isDir(path);
-      if (!is_dir) {
-        FS_LOGI("stat: '%s' does not exist", path);
+    PathView name_internal = internalPath(path);
+    bool is_file_name = !name_internal.endsWith('/');
+    PathView name = name_internal.trimTrailingSlash();
+    LockGuard guard(mutex);
+    DirNode<RegEntry> *p_node = tree.find(name);
+    if (p_node != nullptr) {
+      if (p_node->isDir()) {
+        return statContent(true, path, nullptr, st);
+      }
+      if (!is_file_name) {
+        FS_LOGI("stat: '%s' is not a directory", path);
+        errno = ENOTDIR;
         return -1;
       }
-    } else {
-      p_memory = getContent(mem_entry);
+      return statContent(false, path, getContent(*p_node->value), st);
+    }
+    if (!images.empty()) {
+      RegContentMemory image_content;
+      if (is_file_name && getImageContent(name.data(), image_content)) {
+        return statContent(false, path, &image_content, st);
+      }
+      if (isImageDir(name)) {
+        return statContent(true, path, nullptr, st);
+      }
     }
-    return statContent(is_dir, path, p_memory, st);
+    FS_LOGI("stat: '%s' does not exist", path);
+    errno = ENOENT;
+    return -1;
   }
 
   off_t lseek(int fd, off_t offset, int whence) override {
-    FS_LOGI("lseek: fd='%%' ", fd);
+    FS_LOGI("lseek: fd='%d' ", fd);
     RegEntry &entry = Registry::DefaultRegistry().getEntry(fd);
     RegContentMemory *p_memory = getContent(entry);
     if (p_memory == nullptr) {
       return -1;
     }
+    // determine the new position
+    long pos = 0;
     switch (whence) {
     case SEEK_SET:
-      p_memory->current_pos = offset;
-      if (p_memory->current_pos > p_memory->size) {
-        int diff = p_memory->size - p_memory->current_pos;
-        offset -= diff;
-        p_memory->current_pos = p_memory->size - 1;
-      }
+      pos = offset;
       break;
     case SEEK_CUR:
-      p_memory->current_pos += offset;
-      if (p_memory->current_pos > p_memory->size) {
-        int diff = p_memory->size - p_memory->current_pos;
-        offset -= diff;
-        p_memory->current_pos = p_memory->size - 1;
-      }
+      pos = p_memory->current_pos + offset;
       break;
     case SEEK_END:
-      long pos = p_memory->size - offset;
-      if (pos < 0) {
-        p_memory->current_pos = 0;
-        offset = offset + p_memory->current_pos;
-      } else {
-        p_memory->current_pos = pos;
-      }
+      pos = p_memory->length() + offset;
       break;
+    default:
+      return -1;
+    }
+    if (pos < 0) {
+      FS_LOGW("lseek: invalid position %ld", pos);
+      return -1;
+    }
+    // read only content ends at its size: writable files can get a gap which
+    // is filled with 0 by the next write
+    if (p_memory->p_ram == nullptr && (size_t)pos > p_memory->length()) {
+      pos = p_memory->length();
     }
-    return offset;
+    p_memory->current_pos = pos;
+    return pos;
   }
 
   // directory operations
   DIR *opendir(const char *name) override {
     FS_LOGI("opendir(%s)", name);
+    PathView dir = internalPath(name).trimTrailingSlash();
+    LockGuard guard(mutex);
+    DirNode<RegEntry> *p_node = tree.find(dir);
+    if (p_node != nullptr && !p_node->isDir()) {
+      FS_LOGW("opendir: %s is not a directory", name);
+      errno = ENOTDIR;
+      return nullptr;
+    }
+    if (p_node == nullptr && !isImageDir(dir)) {
+      FS_LOGW("opendir: %s does not exist", name);
+      errno = ENOENT;
+      return nullptr;
+    }
     DIR_EXT *result = new DIR_EXT();
     result->p_file_system = this;
-    result->dir = internalFileName(name, api_files_with_prefix);
-
-    // find matching files
-    for (RegEntry *entry : files) {
-      // cut off prefix from file names
-      const char *file_name = entry->file_name;
-      FS_LOGD("-> %s %s", file_name, result->dir);
-      if (Str(file_name).startsWith(result->dir)) {
-        FS_LOGD("--> %s %s", file_name, result->dir);
-        result->files.push_back(entry);
-      }
-    }
-    result->actual_dirent.d_type = DT_REG;
-    result->pos = 0;
-    FS_LOGD("=> opendir: %d files", result->files.size());
+    result->dir = dir.data();
+    result->dir_len = dir.size();
+    result->p_node = p_node;
+    result->p_mutex = &mutex;
+    result->rewind();
+    open_dirs.push_back(result);
     return (DIR *)result;
   }
 
+  /// provides the files and subdirectories of the tree followed by the ones
+  /// of the mounted images
   dirent *readdir(DIR *dir) override {
     FS_TRACEI();
     DIR_EXT *p_dir = (DIR_EXT *)dir;
-    if (p_dir->pos >= p_dir->files.size()) {
-      FS_LOGD("==> readdir: pos=%d size=%d END", p_dir->pos,
-              p_dir->files.size());
-      p_dir->pos++;
+    if (p_dir == nullptr || p_dir->magic_id != MAGIC_DIR_EXT) {
+      FS_LOGE("readdir: invalid DIR");
+      errno = EBADF;
       return nullptr;
     }
-    RegEntry *entry = p_dir->files[p_dir->pos];
-    p_dir->pos++;
-
-    // we return only the file name w/o path
-    int len = strlen(p_dir->dir);
-    if (entry->file_name[len] == '/') {
-      len++;
+    LockGuard guard(mutex);
+    DirNode<RegEntry> *p_node = p_dir->p_next;
+    if (p_node != nullptr) {
+      p_dir->p_next = p_node->next_sibling;
+      return setDirent(p_dir, p_node->base_name, strlen(p_node->base_name),
+                       p_node->isDir());
     }
-    const char *result_name = (entry->file_name) + len;
-
-    // copy filname to dirent
-    strncpy(p_dir->actual_dirent.d_name, result_name, MAXNAMLEN);
-    FS_LOGD("==> readdir: pos=%d size=%d %s", p_dir->pos, p_dir->files.size(),
-            result_name);
-    return &(p_dir->actual_dirent);
+    while (p_dir->image_idx < images.size()) {
+      const FileImage *p_image = images[p_dir->image_idx];
+      if (!p_dir->image_started) {
+        p_dir->image_pos = p_image->dirStart(p_dir->dir, p_dir->dir_len);
+        p_dir->image_end = p_image->dirEnd(p_dir->dir, p_dir->dir_len);
+        p_dir->image_started = true;
+      }
+      while (p_dir->image_pos < p_dir->image_end) {
+        const char *file_name = p_image->entries[p_dir->image_pos].name;
+        const char *result_name =
+            file_name + p_dir->dir_len + (p_dir->dir_len > 0 ? 1 : 0);
+        const char *slash = strchr(result_name, '/');
+        size_t len = slash != nullptr ? slash - file_name : strlen(file_name);
+        // a subdirectory is reported only once
+        p_dir->image_pos = slash != nullptr ? p_image->dirEnd(file_name, len)
+                                            : p_dir->image_pos + 1;
+        // entries which are also in the tree have already been reported
+        if (p_dir->p_node != nullptr && tree.find(file_name, len) != nullptr) {
+          continue;
+        }
+        return setDirent(p_dir, result_name, file_name + len - result_name,
+                         slash != nullptr);
+      }
+      p_dir->image_idx++;
+      p_dir->image_started = false;
+    }
+    FS_LOGD("==> readdir: pos=%d END", p_dir->pos);
+    return nullptr;
   }
 
   int closedir(DIR *dir) override {
     FS_TRACEI();
     DIR_EXT *p_dir = (DIR_EXT *)dir;
     if (p_dir != nullptr) {
+      LockGuard guard(mutex);
+      for (auto it = open_dirs.begin(); it != open_dirs.end(); ++it) {
+        if (*it == p_dir) {
+          open_dirs.erase(it);
+          break;
+        }
+      }
       delete p_dir;
     }
     return 0;
   }
 
+  /// removes a file which was created with O_CREAT: static files can not be
+  /// removed
   int unlink(const char *path) override {
-    FS_LOGE("unlink not supported");
-    return -1;
+    FS_LOGI("unlink: path='%s' ", path);
+    LockGuard guard(mutex);
+    RegEntry &mem_entry = get(path);
+    RegContentMemory *p_memory = getContent(mem_entry);
+    if (p_memory == nullptr) {
+      FS_LOGE("unlink: '%s' does not exist", path);
+      errno = ENOENT;
+      return -1;
+    }
+    if (p_memory->p_ram == nullptr || p_memory->data != nullptr) {
+      FS_LOGE("unlink not supported for '%s'", path);
+      errno = EPERM;
+      return -1;
+    }
+    // the data stays available for the open files
+    RamFile *p_ram = p_memory->p_ram;
+    if (p_ram->open_count == 0) {
+      delete p_ram;
+    } else {
+      p_ram->unlinked = true;
+    }
+    // the open directories must not point to the removed node
+    DirNode<RegEntry> *p_node = tree.find(mem_entry.file_name);
+    for (DIR_EXT *p_dir : open_dirs) {
+      if (p_dir->p_next == p_node) {
+        p_dir->p_next = p_node->next_sibling;
+      }
+    }
+    tree.remove(mem_entry.file_name);
+    for (auto it = files.begin(); it != files.end(); ++it) {
+      if (*it == &mem_entry) {
+        files.erase(it);
+        break;
+      }
+    }
+    delete &mem_entry;
+    return 0;
   }
 
   virtual void *mem_map(const char *path, size_t *p_size) override {
     const char *name_internal = internalFileName(path, true);
     FS_LOGI("mem_map(%s)", name_internal);
+    LockGuard guard(mutex);
     RegEntry &entry = get(name_internal);
+    RegContentMemory image_content;
+    if (!entry && getImageContent(name_internal, image_content)) {
+      if (image_content.progmem) {
+        FS_LOGW("mem_map: %s is in PROGMEM", name_internal);
+        return nullptr;
+      }
+      if (p_size != nullptr) {
+        *p_size = image_content.size;
+      }
+      return (void *)image_content.data;
+    }
     if (!entry) {
       FS_LOGW("mem_map: %s not found", name_internal);
       return nullptr;
@@ -415,8 +712,19 @@ public:
       FS_LOGE("mem_map: %s no RegContentMemory", path);
       return nullptr;
     }
+    if (p_memory->isCompressed()) {
+      FS_LOGW("mem_map: %s is compressed", path);
+      return nullptr;
+    }
+    // an overlay is only contiguous as long as nothing has been written
+    RamFile *p_ram = p_memory->p_ram;
+    if (p_ram != nullptr && (p_memory->data == nullptr ||
+                             p_ram->buffer.chunkCount() > 0)) {
+      FS_LOGW("mem_map: %s is not contiguous", path);
+      return nullptr;
+    }
     if (p_size != nullptr) {
-      *p_size = p_memory->size;
+      *p_size = p_memory->length();
     }
     return (void *)p_memory->data;
   }
@@ -426,42 +734,218 @@ public:
 protected:
   // Files in Directory
   Vector<RegEntry *> files;
+  // Files and directories for fast lookups by name
+  DirTree<RegEntry> tree;
+  // Open directories: their position is moved when a file is removed
+  Vector<DIR_EXT *> open_dirs;
+  // Mounted images which were generated by fs-image
+  Vector<const FileImage *, 2> images;
+  // Preallocated contents for open files
+  ObjectPool<RegContentMemory> content_pool{FS_OPEN_FILES_POOL_SIZE};
+  // Preallocated blocks for the data of writable files
+  ObjectPool<Chunk<FS_RAM_CHUNK_SIZE>> chunk_pool{FS_RAM_CHUNK_POOL_SIZE};
+  // Protects the pools and the writable files
+  Mutex mutex;
   // The ESP32 virtual file system audomatically removes the prefix, for all
   // other implementations we need to do this outselfs
   bool api_files_with_prefix;
 #ifdef FS_IS_MBED
   MBEDFileSystem *p_mbed = nullptr;
 #endif
-  // gets a file entry by index
-  RegEntry &getEntry(int fd) {
-    RegEntry *e = files[fd];
-    return *e;
+  // gets a file entry by name: locked, because it is also used by the public
+  // isValidFile() and get()
+  RegEntry &getEntry(const char *fileName) {
+    LockGuard guard(mutex);
+    DirNode<RegEntry> *p_node = tree.find(fileName);
+    if (p_node != nullptr && !p_node->isDir()) {
+      return *p_node->value;
+    }
+    return NoRegEntry;
   }
 
-  // gets a file entry by name
-  RegEntry &getEntry(const char *fileName) {
-    for (auto e : files) {
-      const char *entry_file_name = e->file_name;
-      if (Str(fileName).equals(entry_file_name)) {
-        return *e;
+  // adds a in memory file: len is the uncompressed size
+  bool addMemory(const char *name, const void *data, size_t len,
+                 size_t compressed_size) {
+    const char *name_internal = internalFileName(name, true);
+    FS_LOGI("add: name='%s' len=%d", name_internal, len);
+    if (&Registry::DefaultRegistry().fileSystem(name) != this) {
+      FS_LOGE("File %s not vaid for  %s in %s", name, this->pathPrefix(),
+              Registry::DefaultRegistry().fileSystem(name).name());
+      return false;
+    }
+    LockGuard guard(mutex);
+    // update existing entry if name already registered
+    RegEntry &existing = getEntry(name_internal);
+    if (existing) {
+      FS_LOGI("add: updating existing entry '%s'", name_internal);
+      RegContentMemory *content = static_cast<RegContentMemory *>(existing.content);
+      if (content->p_ram != nullptr) {
+        FS_LOGE("add: '%s' is a writable file", name_internal);
+        return false;
       }
+      content->data = (uint8_t *)data;
+      content->size = len;
+      content->compressed_size = compressed_size;
+      return true;
     }
-    return NoRegEntry;
+    // setup content
+    RegContentMemory *content = new RegContentMemory();
+    content->data = (uint8_t *)data;
+    content->size = len;
+    content->compressed_size = compressed_size;
+    return addEntry(name_internal, content) != nullptr;
   }
 
-  bool isDir(const char *fileName) {
-    int len = strlen(fileName);
-    for (auto e : files) {
-      const char *entry_file_name = e->file_name;
-      Str str_entry_file_name(entry_file_name);
-      if ((Str(fileName).isEmpty() || str_entry_file_name.startsWith(fileName)) &&
-          str_entry_file_name.length() > len) {
+  // provides the content of a file of the mounted images
+  bool getImageContent(const char *name_internal, RegContentMemory &content) {
+    for (const FileImage *p_image : images) {
+      const ImageEntry *p_entry = p_image->find(name_internal);
+      if (p_entry != nullptr) {
+        content.data = p_image->data + p_entry->offset;
+        content.size = p_entry->size;
+        content.progmem = FS_IMAGE_PROGMEM;
         return true;
       }
     }
     return false;
   }
 
+  // registers a copy of the image content as new file entry
+  RegContentMemory *addImageEntry(const char *name_internal,
+                                  RegContentMemory &content) {
+    RegContentMemory *p_new = new RegContentMemory();
+    p_new->data = content.data;
+    p_new->size = content.size;
+    p_new->progmem = content.progmem;
+    return addEntry(name_internal, p_new) != nullptr ? p_new : nullptr;
+  }
+
+  // registers a new file entry: returns nullptr if the name is not valid
+  RegEntry *addEntry(const char *name_internal, RegContentMemory *content) {
+    RegEntry *entry = new RegEntry();
+    entry->p_file_system = this;
+    entry->file_name = strdup(name_internal);
+    entry->file_name_owned = true;
+    entry->content = content;
+    if (tree.add(entry->file_name, entry) == nullptr) {
+      FS_LOGE("'%s' is not a valid file name", name_internal);
+      delete entry;
+      return nullptr;
+    }
+    files.push_back(entry);
+    FS_LOGD("files: %d", files.size());
+    return entry;
+  }
+
+  // creates a new empty writable file
+  RegContentMemory *createRamFile(const char *name_internal) {
+    FS_LOGI("createRamFile: name='%s'", name_internal);
+    RegContentMemory *content = new RegContentMemory();
+    if (addEntry(name_internal, content) == nullptr) {
+      return nullptr;
+    }
+    content->p_ram = new RamFile(chunk_pool);
+    return content;
+  }
+
+  // checks if the directory exists in one of the mounted images
+  bool isImageDir(PathView dir) {
+    for (const FileImage *p_image : images) {
+      if (p_image->isDir(dir.data(), dir.size())) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // copies the name to the dirent
+  dirent *setDirent(DIR_EXT *p_dir, const char *name, size_t len, bool isDir) {
+    if (len > MAXNAMLEN) {
+      len = MAXNAMLEN;
+    }
+    memcpy(p_dir->actual_dirent.d_name, name, len);
+    p_dir->actual_dirent.d_name[len] = 0;
+    p_dir->actual_dirent.d_type = isDir ? DT_DIR : DT_REG;
+    p_dir->pos++;
+    FS_LOGD("==> readdir: pos=%d %s", p_dir->pos, p_dir->actual_dirent.d_name);
+    return &(p_dir->actual_dirent);
+  }
+
+  // provides the data from the decompressed actual block: a new block is only
+  // decompressed when we move out of the actual block
+  ssize_t readCompressed(RegContentMemory *p_memory, size_t max,
+                         const void **p_data) {
+    CompressedBlocks blocks(p_memory->data, p_memory->compressed_size);
+    size_t pos = p_memory->current_pos;
+    size_t idx = pos / blocks.blockSize();
+    if (p_memory->p_block == nullptr) {
+      p_memory->p_block = new uint8_t[blocks.blockSize()];
+    }
+    if (p_memory->block_idx != (int)idx) {
+      if (blocks.readBlock(idx, p_memory->p_block) < 0) {
+        FS_LOGE("readCompressed: invalid block %d", (int)idx);
+        p_memory->block_idx = -1;
+        return -1;
+      }
+      p_memory->block_idx = idx;
+    }
+    size_t offset = pos % blocks.blockSize();
+    size_t len = blocks.blockLen(idx) - offset;
+    if (len > max) len = max;
+    p_memory->current_pos += len;
+    *p_data = p_memory->p_block + offset;
+    FS_LOGD("=> readCompressed: pos=%d block=%d -> %d", pos, (int)idx, len);
+    return len;
+  }
+
+  // gives the content of a closed file back to the pool: an unlinked RamFile
+  // is deleted with the last reference
+  void releaseContent(RegContentMemory *p_memory) {
+    LockGuard guard(mutex);
+    RamFile *p_ram = p_memory->p_ram;
+    if (p_ram != nullptr && --p_ram->open_count == 0 && p_ram->unlinked) {
+      delete p_ram;
+    }
+    content_pool.release(p_memory);
+  }
+
+  // copies the data of a FileImage which is stored in PROGMEM
+  ssize_t readProgmem(RegContentMemory *p_memory, void *data, size_t max) {
+    size_t pos = p_memory->current_pos;
+    if (pos >= p_memory->size) return 0;
+    size_t len = p_memory->size - pos;
+    if (len > max) len = max;
+#if FS_IMAGE_PROGMEM
+    memcpy_P(data, p_memory->data + pos, len);
+#else
+    memcpy(data, p_memory->data + pos, len);
+#endif
+    p_memory->current_pos += len;
+    return len;
+  }
+
+  // makes a static file writable: only the modified chunks are copied to RAM,
+  // the others are still provided from the original data
+  void createOverlay(RegContentMemory *content) {
+    FS_LOGI("createOverlay: size=%d", (int)content->size);
+    content->p_ram = new RamFile(chunk_pool);
+    content->p_ram->buffer.setBase(content->data, content->size);
+  }
+
+  // checks if the directory exists in the tree or in the mounted images
+  bool isDir(PathView name) {
+    DirNode<RegEntry> *p_node = tree.find(name);
+    if (p_node != nullptr) {
+      return p_node->isDir();
+    }
+    return isImageDir(name);
+  }
+
+  // internal name of the path as PathView
+  PathView internalPath(const char *path) {
+    return PathView(internalFileName(path, api_files_with_prefix));
+  }
+
   RegContentMemory *getContent(RegEntry &entry) {
     FS_TRACED();
     RegContentMemory *result = nullptr;
@@ -480,7 +964,7 @@ protected:
       st->st_size = 0;
       st->st_mode = S_IFDIR;
     } else {
-      st->st_size = p_memory->size;
+      st->st_size = p_memory->length();
       st->st_mode = S_IFREG;
     }
     FS_LOGD("=> stat path=%s -> size=%d ", fileName, st->st_size);
@@ -17,42 +17,123 @@ public:
 }
 #else
 
+#include "Collections/IntrusiveList.h"
+#include "FileSystems/BlockCache.h"
+#include "FileSystems/DirCache.h"
 #include "FileSystems/Registry.h"
+#include "FileSystems/StatCache.h"
+#include <errno.h>
 #include <fcntl.h>
+#ifdef IS_DESKTOP
+#  include <chrono>
+#endif
 
-#define MAGIC_DIR_SD 12345679
+#define MAGIC_DIR_SD 12345680
 
 typedef SDClass ES_SD;
 
 namespace file_systems {
 
 /**
- * @brief Custom extension of DIR
+ * @brief Custom extension of DIR: the entries are provided by the cached
+ * listing or, if there is none, directly by the directory File
  */
 struct DIR_SD : public DIR_BASE {
   DIR_SD() { magic_id = MAGIC_DIR_SD; }
   /// dirent related to this DIR
   dirent actual_dirent;
-  /// all unprocessed files: only used by FileSystemMemory!
+  /// directory which is read if there is no listing
   File dir;
+  /// snapshot of the directory: nullptr if the dir cache is not active
+  DirListing *p_listing = nullptr;
+  /// index of the next entry
+  int pos = 0;
+
+  virtual bool seek(off_t offset) {
+    if (offset < 0) return false;
+    if (p_listing != nullptr) {
+      if (offset > p_listing->size()) return false;
+      pos = offset;
+      return true;
+    }
+    dir.rewindDirectory();
+    pos = 0;
+    while (pos < offset) {
+      File next = dir.openNextFile();
+      if (!next) return false;
+      next.close();
+      pos++;
+    }
+    return true;
+  }
+  virtual off_t tell() { return pos; }
+  virtual ssize_t size() {
+    if (p_listing != nullptr) return p_listing->size();
+    // count the entries and return to the actual position
+    int actual = pos;
+    seek(INT32_MAX);
+    int result = pos;
+    seek(actual);
+    return result;
+  };
 };
 
 /**
- * @brief Content with File
+ * @brief Content with File: we keep track of the position ourself, so that
+ * the File only needs to be moved when the data is not in the cache. Small
+ * writes are collected in the write buffer.
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
-struct RegContentFile : public RegContent {
+struct RegContentFile : public RegContent,
+                        public IntrusiveListNode<RegContentFile> {
   RegContentFile(File f) {
     id = ContentFile;
     file = f;
   }
+  ~RegContentFile() {
+    free(path);
+    delete[] p_write;
+  }
   File file;
+  /// name of the file on the SD
+  char *path = nullptr;
+  /// identifies the cached blocks: shared by all open files with the same path
+  uint32_t file_id = 0;
+  /// flags provided by open
+  int flags = 0;
+  /// position of the open file
+  size_t pos = 0;
+  /// position of the File
+  size_t file_pos = 0;
+  /// write buffer (allocated by the first small write): 0 size for no buffer
+  uint8_t *p_write = nullptr;
+  size_t write_size = 0;
+  /// buffered data which needs to be written at write_pos
+  size_t write_pos = 0;
+  size_t write_len = 0;
+  /// time in ms of the oldest buffered data
+  uint32_t write_time = 0;
+
+  /// file size including the buffered data
+  size_t size() {
+    size_t result = file.size();
+    size_t end = write_pos + write_len;
+    return write_len > 0 && end > result ? end : result;
+  }
 };
 
 /**
  * @brief We provide the posix file operations with the help of the SD library.
- * For the ESP32 we set up a virtual file system.
+ * For the ESP32 we set up a virtual file system. Small reads are served from a
+ * block cache (see setCacheSize()) which is shared by all open files and which
+ * is updated by the writes via this class. Small writes are collected per open
+ * file and written in aligned chunks (see setWriteBufferSize()): the buffer is
+ * written when it is full, after FS_SD_WRITE_FLUSH_MS, on fsync() and close()
+ * and before the file is read. The results of stat() (also for missing files)
+ * are cached (see setStatCacheSize()): changes which are not done via this
+ * class are not visible until the entry is evicted. The same applies to the
+ * directory listings which are kept in RAM (see setDirCacheSize()).
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
@@ -70,109 +151,338 @@ public:
   /// Selects the actual File System to be used for directory searches
   void setFileSystemForSearch() {
     FS_TRACED();
-    DefaultRegistry.setFileSystemForSearch(this);
+    Registry::DefaultRegistry().setFileSystemForSearch(this);
+  }
+
+  /// Defines the number of blocks of the read cache: 0 deactivates the cache
+  bool setCacheSize(int blocks, size_t blockSize = FS_SD_CACHE_BLOCK_SIZE) {
+    LockGuard guard(mutex);
+    cache_blocks = blocks;
+    cache_block_size = blockSize;
+    return cache.begin(blocks, blockSize);
+  }
+
+  /// Provides the read cache (e.g. to check the hits and misses)
+  BlockCache &readCache() { return cache; }
+
+  /// Defines the size of the write buffer for the files which are opened
+  /// afterwards: 0 writes the data directly
+  void setWriteBufferSize(size_t size) { write_buffer_size = size; }
+
+  /// Defines the number of paths in the stat cache: 0 deactivates the cache
+  bool setStatCacheSize(int size) {
+    LockGuard guard(mutex);
+    stat_cache_size = size;
+    return stat_cache.begin(size);
+  }
+
+  /// Provides the stat cache (e.g. to check the hits and misses)
+  StatCache &statCache() { return stat_cache; }
+
+  /// Defines the number of directory listings which are kept in RAM: 0 reads
+  /// the directory entries from the SD on each readdir()
+  bool setDirCacheSize(int size) {
+    LockGuard guard(mutex);
+    dir_cache_size = size;
+    return dir_cache.begin(size);
   }
 
+  /// Provides the directory cache (e.g. to check the hits and misses)
+  DirCache &dirCache() { return dir_cache; }
+
   int open(const char *path, int flags, int mode) override{
     FS_TRACED();
-    File file = getFS().open(path, getMode(flags));
+    const char *sd_path = sdPath(path);
+    if ((flags & O_ACCMODE) != O_RDONLY || (flags & (O_CREAT | O_TRUNC))) {
+      LockGuard guard(mutex);
+      invalidatePath(sd_path);
+    }
+    File file = getFS().open(sd_path, getMode(flags));
     if (!file) {
       FS_LOGE("File does not exist: %s", path);
+      errno = ENOENT;
       return -1;
     }
-    return addOpenFile(path, file);
+    if ((flags & O_ACCMODE) != O_RDONLY || (flags & O_CREAT)) {
+      // the file might have been created
+      LockGuard guard(mutex);
+      dir_cache.invalidateParent(sd_path);
+    }
+    if (isTruncating(flags)) {
+      // other open fds of the file share the cached blocks
+      LockGuard guard(mutex);
+      RegContentFile *p_open = findOpen(sd_path);
+      if (p_open != nullptr) cache.invalidate(p_open->file_id);
+    }
+    return addOpenFile(path, sd_path, file, flags);
   }
 
+  /// small writes are collected in the write buffer, the others are written
+  /// directly at the actual position
   ssize_t write(int fd, const void *data, size_t size) override{
     FS_TRACED();
-    return getFile(fd).write((uint8_t *)data, size);
+    RegContentFile *p_content = getContent(fd);
+    if (p_content == nullptr) return -1;
+    LockGuard guard(mutex);
+    RegContentFile &content = *p_content;
+    if (content.flags & O_APPEND) {
+      content.pos = content.size();
+    }
+    if (size < content.write_size) {
+      ssize_t result = bufferWrite(content, (const uint8_t *)data, size);
+      if (result >= 0 && content.write_len > 0 && FS_SD_WRITE_FLUSH_MS > 0 &&
+          nowMs() - content.write_time >= FS_SD_WRITE_FLUSH_MS) {
+        if (!flushWrite(content)) return -1;
+      }
+      return result;
+    }
+    if (!flushWrite(content)) return -1;
+    int len = writeFile(content, content.pos, (const uint8_t *)data, size);
+    if (len < 0) return -1;
+    content.pos = content.file_pos;
+    return len;
   }
 
+  /// reads via the block cache: reads of complete blocks bypass the cache
   ssize_t read(int fd, void *data, size_t size) override{
     FS_TRACED();
-    return getFile(fd).read((uint8_t *)data, size);
+    RegContentFile *p_content = getContent(fd);
+    if (p_content == nullptr) return -1;
+    LockGuard guard(mutex);
+    if (!flushWrites(p_content->file_id)) return -1;
+    if (cache_blocks > 0 && !cache.isActive()) {
+      cache.begin(cache_blocks, cache_block_size);
+    }
+    if (!cache.isActive()) {
+      int len = readFile(*p_content, p_content->pos, (uint8_t *)data, size);
+      if (len > 0) p_content->pos += len;
+      return len;
+    }
+    return readCached(*p_content, (uint8_t *)data, size);
   }
 
   int close(int fd) override{
     FS_TRACED();
-    getFile(fd).close();
-    free(files[fd]);
-    files[fd] = nullptr;
+    RegContentFile *p_content = getContent(fd);
+    if (p_content == nullptr) return -1;
+    bool ok = true;
+    {
+      LockGuard guard(mutex);
+      ok = flushWrite(*p_content);
+      p_content->file.close();
+      open_files.remove(*p_content);
+      if ((p_content->flags & O_ACCMODE) != O_RDONLY) {
+        invalidatePath(p_content->path);
+      }
+      // the next open assigns a new id
+      if (!isOpen(p_content->file_id)) {
+        cache.invalidate(p_content->file_id);
+      }
+    }
+    Registry::DefaultRegistry().closeFile(fd);
+    return ok ? 0 : -1;
+  }
+
+  /// writes the buffered data of the file
+  int fsync(int fd) override {
+    FS_TRACED();
+    RegContentFile *p_content = getContent(fd);
+    if (p_content == nullptr) return -1;
+    LockGuard guard(mutex);
+    if (!flushWrite(*p_content)) return -1;
+    p_content->file.flush();
     return 0;
   }
 
   int fstat(int fd, struct stat *st) override{
     FS_TRACED();
-    File *p_f = &getFile(fd);
-    st->st_size = p_f->size();
-    st->st_mode = p_f->isDirectory() ? S_IFDIR : S_IFREG;
+    RegContentFile *p_content = getContent(fd);
+    if (p_content == nullptr) return -1;
+    LockGuard guard(mutex);
+    st->st_size = p_content->size();
+    st->st_mode = p_content->file.isDirectory() ? S_IFDIR : S_IFREG;
     st->st_ino = fd;
     return 0;
   }
 
+  /// the result is taken from the stat cache if possible
   int stat(const char *path, struct stat *st) override{
-    File file = getFS().open(path, getMode(flags));
-    st->st_size = p_f->size();
-    st->st_mode = p_f->isDirectory() ? S_IFDIR : S_IFREG;
-    file.close();
+    FS_TRACED();
+    const char *sd_path = sdPath(path);
+    StatInfo info;
+    {
+      LockGuard guard(mutex);
+      RegContentFile *p_open = findOpen(sd_path);
+      if (p_open != nullptr) flushWrites(p_open->file_id);
+      if (stat_cache_size > 0 && !stat_cache.isActive()) {
+        stat_cache.begin(stat_cache_size);
+      }
+      if (!stat_cache.get(sd_path, info)) {
+        File file = getFS().open(sd_path, getMode(O_RDONLY));
+        info.exists = file;
+        if (info.exists) {
+          info.size = file.size();
+          info.is_dir = file.isDirectory();
+          file.close();
+        }
+        stat_cache.put(sd_path, info);
+      }
+    }
+    if (!info.exists) {
+      FS_LOGI("stat: '%s' does not exist", path);
+      errno = ENOENT;
+      return -1;
+    }
+    st->st_size = info.size;
+    st->st_mode = info.is_dir ? S_IFDIR : S_IFREG;
+    return 0;
+  }
+
+  int unlink(const char *path) override {
+    FS_TRACED();
+    const char *sd_path = sdPath(path);
+    LockGuard guard(mutex);
+    invalidatePath(sd_path);
+    dir_cache.invalidateParent(sd_path);
+    if (!getFS().remove(sd_path)) {
+      FS_LOGW("unlink: '%s' could not be removed", path);
+      errno = ENOENT;
+      return -1;
+    }
+    return 0;
   }
 
-  off_t lseek(int fd, off_t offset, int mode) override{
+  /// only updates the position: the File is moved by the next read or write
+  off_t lseek(int fd, off_t offset, int whence) override{
     FS_TRACED();
-    // SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2};
-    #ifdef SEEK_MODE_SUPPORTED
-      return getFile(fd).seek(offset, (fs::SeekMode)mode);
-    #else
-      if(mode!=0) return 0;
-      return getFile(fd).seek(offset);
-    #endif
+    RegContentFile *p_content = getContent(fd);
+    if (p_content == nullptr) return -1;
+    LockGuard guard(mutex);
+    size_t size = p_content->size();
+    long pos = 0;
+    switch (whence) {
+    case SEEK_SET:
+      pos = offset;
+      break;
+    case SEEK_CUR:
+      pos = p_content->pos + offset;
+      break;
+    case SEEK_END:
+      pos = size + offset;
+      break;
+    default:
+      return -1;
+    }
+    if (pos < 0) {
+      FS_LOGW("lseek: invalid position %ld", pos);
+      return -1;
+    }
+    // we can not move behind the end
+    if ((size_t)pos > size) {
+      pos = size;
+    }
+    p_content->pos = pos;
+    return pos;
+  }
+
+  off_t tell(int fd) override {
+    RegContentFile *p_content = getContent(fd);
+    return p_content == nullptr ? -1 : p_content->pos;
   }
 
+  /// the entries are taken from the cached listing of the directory if
+  /// possible
   DIR *opendir(const char *path) override{
     FS_LOGD("opendir: %s", path);
-    // remove path prefix if necessary
-    const char *file_name = path + filenameOffset();
-    FS_LOGD("SD.open %s", file_name);
-    // File file = getFS().open(file_name, FILE_READ);
-    File file = SD.open(file_name, FILE_READ);
+    const char *sd_path = sdPath(path);
+    DirListing *p_listing = nullptr;
+    uint32_t version = 0;
+    bool use_cache = false;
+    {
+      LockGuard guard(mutex);
+      if (dir_cache_size > 0 && !dir_cache.isActive()) {
+        dir_cache.begin(dir_cache_size);
+      }
+      use_cache = dir_cache.isActive();
+      if (use_cache) {
+        p_listing = dir_cache.get(sd_path);
+        version = dir_cache.version();
+      }
+    }
+    DIR_SD *result = new DIR_SD();
+    result->p_file_system = this;
+    if (p_listing != nullptr) {
+      result->p_listing = p_listing;
+      return result;
+    }
+
+    File file = getFS().open(sd_path, getMode(O_RDONLY));
     if (!file) {
-      FS_LOGW("dir not found %s", file_name);
+      FS_LOGW("dir not found %s", sd_path);
+      delete result;
       return nullptr;
     }
     if (!file.isDirectory()) {
-      FS_LOGW("file not a directory %s", file_name);
+      FS_LOGW("file not a directory %s", sd_path);
+      file.close();
+      delete result;
       return nullptr;
     }
-    // save directory to scan
-    DIR_SD *result = new DIR_SD();
-    result->p_file_system = this;
-    result->dir = file;
-    FS_LOGD("=> %s", file.name());
+    if (use_cache) {
+      p_listing = readListing(sd_path, file);
+    }
+    if (p_listing != nullptr) {
+      file.close();
+      LockGuard guard(mutex);
+      dir_cache.put(p_listing, version);
+      result->p_listing = p_listing;
+    } else {
+      // read the entries on demand
+      result->dir = file;
+    }
     return result;
   }
 
   dirent *readdir(DIR *dir) override{
     FS_TRACED();
     DIR_SD *pdir = (DIR_SD *)dir;
+    if (pdir == nullptr || pdir->magic_id != MAGIC_DIR_SD) {
+      FS_LOGE("readdir: invalid DIR");
+      errno = EBADF;
+      return nullptr;
+    }
+    dirent &info = pdir->actual_dirent;
+    DirListing *p_listing = pdir->p_listing;
+    if (p_listing != nullptr) {
+      if (pdir->pos >= p_listing->size()) return nullptr;
+      setDirent(info, p_listing->name(pdir->pos),
+                p_listing->isDirectory(pdir->pos));
+      pdir->pos++;
+      return &info;
+    }
+
     File next = pdir->dir.openNextFile();
     if (!next) {
       FS_LOGD("openNextFile() did not provide new file");
       return nullptr;
     }
-
-    // fill dirent with filename and file type
-    dirent &info = static_cast<DIR_SD *>(pdir)->actual_dirent;
-    strncpy(info.d_name, next.name(), FILENAME_MAX);
-    info.d_type = next.isDirectory() ? DT_DIR : DT_REG;
-
+    setDirent(info, next.name(), next.isDirectory());
+    next.close();
+    pdir->pos++;
     return &info;
   }
 
-  int closedir(DIR *pdir) override{
+  int closedir(DIR *dir) override{
     FS_TRACED();
-    if (pdir != nullptr) {
-      free(pdir);
+    DIR_SD *pdir = (DIR_SD *)dir;
+    if (pdir == nullptr) return -1;
+    if (pdir->p_listing != nullptr) {
+      LockGuard guard(mutex);
+      dir_cache.release(pdir->p_listing);
+    } else {
+      pdir->dir.close();
     }
+    delete pdir;
     return 0;
   }
 
@@ -180,8 +490,23 @@ public:
 
 protected:
   ES_SD *p_fs = nullptr;
-  Vector<File *> files;
   const char* FS_NAME_SD = "FileSystemSD";
+  // protects the cache and the list of open files
+  Mutex mutex;
+  // read cache which is shared by all open files
+  BlockCache cache;
+  // results of stat() by path
+  StatCache stat_cache;
+  int stat_cache_size = FS_SD_STAT_CACHE_SIZE;
+  // listings of the directories
+  DirCache dir_cache;
+  int dir_cache_size = FS_SD_DIR_CACHE_SIZE;
+  int cache_blocks = FS_SD_CACHE_BLOCKS;
+  size_t cache_block_size = FS_SD_CACHE_BLOCK_SIZE;
+  // all open files
+  IntrusiveList<RegContentFile> open_files;
+  uint32_t last_file_id = 0;
+  size_t write_buffer_size = FS_SD_WRITE_BUFFER_SIZE;
 
 #ifdef ESP32
   esp_vfs_t myfs;
@@ -189,29 +514,267 @@ protected:
 
   void setup(const char *path) {
     setFileSystemForSearch();
-    DefaultRegistry.add(*this);
+    Registry::DefaultRegistry().add(*this);
     filename_offset = strlen(path);
   }
 
   // FS file system
   ES_SD &getFS() { return *p_fs; }
 
-  // Returns the File by fd
-  File &getFile(int fd) {
-    RegEntry &entry = DefaultRegistry.getEntry(fd);
-    RegContentFile *cf = (RegContentFile *)entry.content;
-    return cf->file;
+  // path on the SD w/o the path prefix
+  const char *sdPath(const char *path) {
+    const char *result = path + filenameOffset();
+    return *result == 0 ? "/" : result;
+  }
+
+  // Returns the content of the open file or nullptr
+  RegContentFile *getContent(int fd) {
+    RegEntry &entry = Registry::DefaultRegistry().getEntry(fd);
+    if (entry.p_file_system != this || entry.content == nullptr ||
+        entry.content->id != ContentFile) {
+      FS_LOGE("invalid fd %d", fd);
+      return nullptr;
+    }
+    return (RegContentFile *)entry.content;
   }
 
   // Opens the file and adds the File object as content
-  int addOpenFile(const char *path, File &file) {
-    RegEntry &entry = DefaultRegistry.openFile(path);
-    if (entry) {
-      entry.content = new RegContentFile(file);
-      return entry.fileID;
-    } else {
+  int addOpenFile(const char *path, const char *sdPath, File &file,
+                  int flags) {
+    RegEntry &entry = Registry::DefaultRegistry().openFile(path, *this);
+    if (&entry == &NoRegEntry) {
+      file.close();
       return -1;
     }
+    RegContentFile *p_content = new RegContentFile(file);
+    p_content->path = strdup(sdPath);
+    p_content->flags = flags;
+    if ((flags & O_ACCMODE) != O_RDONLY) {
+      p_content->write_size = write_buffer_size;
+    }
+    // FILE_WRITE starts at the end
+    p_content->pos = p_content->file_pos = file.position();
+    {
+      LockGuard guard(mutex);
+      p_content->file_id = fileId(sdPath);
+      open_files.push_back(*p_content);
+    }
+    entry.content = p_content;
+    return entry.fileID;
+  }
+
+  // the open files of the same path share the id
+  uint32_t fileId(const char *sdPath) {
+    RegContentFile *p_open = findOpen(sdPath);
+    if (p_open != nullptr) return p_open->file_id;
+    if (++last_file_id == 0) last_file_id = 1;
+    return last_file_id;
+  }
+
+  RegContentFile *findOpen(const char *sdPath) {
+    for (auto &content : open_files) {
+      if (strcmp(content.path, sdPath) == 0) return &content;
+    }
+    return nullptr;
+  }
+
+  bool isOpen(uint32_t fileId) {
+    for (auto &content : open_files) {
+      if (content.file_id == fileId) return true;
+    }
+    return false;
+  }
+
+  // moves the File to the indicated position if necessary
+  bool moveFile(RegContentFile &content, size_t pos) {
+    if (content.file_pos == pos) return true;
+    if (!content.file.seek(pos)) {
+      FS_LOGW("seek to %d failed", (int)pos);
+      return false;
+    }
+    content.file_pos = pos;
+    return true;
+  }
+
+  // writes directly to the File and drops the affected cached blocks
+  int writeFile(RegContentFile &content, size_t pos, const uint8_t *data,
+                size_t len) {
+    if (!moveFile(content, pos)) return -1;
+    size_t result = content.file.write(data, len);
+    // with FILE_WRITE some SD libraries always append
+    size_t end = content.file.position();
+    content.file_pos = end;
+    if (result > 0 && cache.isActive()) {
+      size_t block_size = cache.blockSize();
+      cache.invalidate(content.file_id, (end - result) / block_size,
+                       (end - 1) / block_size);
+    }
+    if (result > 0) invalidatePath(content.path);
+    return result;
+  }
+
+  // drops the cached information of the path which is changed
+  void invalidatePath(const char *sdPath) { stat_cache.invalidate(sdPath); }
+
+  // reads all entries of the directory: nullptr if there is not enough memory
+  DirListing *readListing(const char *sdPath, File &dir) {
+    DirListing *p_listing = new DirListing(sdPath);
+    if (p_listing == nullptr) return nullptr;
+    while (true) {
+      File next = dir.openNextFile();
+      if (!next) break;
+      bool ok = p_listing->add(next.name(), next.isDirectory());
+      next.close();
+      if (!ok) {
+        FS_LOGW("not enough memory for the listing of %s", sdPath);
+        delete p_listing;
+        dir.rewindDirectory();
+        return nullptr;
+      }
+    }
+    return p_listing;
+  }
+
+  // fills the dirent: the name is truncated if necessary
+  static void setDirent(dirent &info, const char *name, bool isDir) {
+    size_t len = strlen(name);
+    if (len >= sizeof(info.d_name)) len = sizeof(info.d_name) - 1;
+    memcpy(info.d_name, name, len);
+    info.d_name[len] = 0;
+    info.d_type = isDir ? DT_DIR : DT_REG;
+  }
+
+  // collects the data in the write buffer: it is written when it reaches the
+  // next aligned position
+  ssize_t bufferWrite(RegContentFile &content, const uint8_t *data,
+                      size_t size) {
+    if (content.p_write == nullptr) {
+      content.p_write = new uint8_t[content.write_size];
+      if (content.p_write == nullptr) {
+        content.write_size = 0;
+        int len = writeFile(content, content.pos, data, size);
+        if (len > 0) content.pos = content.file_pos;
+        return len;
+      }
+    }
+    size_t result = 0;
+    while (result < size) {
+      if (content.write_len > 0 &&
+          content.pos != content.write_pos + content.write_len) {
+        if (!flushWrite(content)) return -1;
+      }
+      if (content.write_len == 0) {
+        content.write_pos = content.pos;
+        content.write_time = nowMs();
+      }
+      size_t limit = content.write_size - content.write_pos % content.write_size;
+      size_t len = limit - content.write_len;
+      if (len > size - result) len = size - result;
+      memcpy(content.p_write + content.write_len, data + result, len);
+      content.write_len += len;
+      content.pos += len;
+      result += len;
+      if (content.write_len == limit && !flushWrite(content)) return -1;
+    }
+    return result;
+  }
+
+  // writes the buffered data of the file
+  bool flushWrite(RegContentFile &content) {
+    if (content.write_len == 0) return true;
+    size_t len = content.write_len;
+    content.write_len = 0;
+    int result = writeFile(content, content.write_pos, content.p_write, len);
+    if (result != (int)len) {
+      FS_LOGE("flush: only %d of %d bytes written", result, (int)len);
+      errno = EIO;
+      return false;
+    }
+    // the SD library appended the data
+    if (content.file_pos != content.write_pos + len) {
+      content.pos = content.file_pos;
+    }
+    return true;
+  }
+
+  // writes the buffered data of all open files with the indicated id
+  bool flushWrites(uint32_t fileId) {
+    bool result = true;
+    for (auto &content : open_files) {
+      if (content.file_id == fileId && !flushWrite(content)) result = false;
+    }
+    return result;
+  }
+
+  // time in ms for the write threshold
+  static uint32_t nowMs() {
+#ifdef IS_DESKTOP
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#else
+    return millis();
+#endif
+  }
+
+  // reads directly from the File at the indicated position
+  int readFile(RegContentFile &content, size_t pos, uint8_t *data,
+               size_t len) {
+    if (!moveFile(content, pos)) return -1;
+    int result = content.file.read(data, len);
+    if (result > 0) content.file_pos += result;
+    return result;
+  }
+
+  // copies the data from the cached blocks: the missing blocks are read
+  ssize_t readCached(RegContentFile &content, uint8_t *data, size_t size) {
+    size_t block_size = cache.blockSize();
+    size_t result = 0;
+    while (result < size) {
+      size_t offset = content.pos % block_size;
+      // complete blocks are copied directly
+      if (offset == 0 && size - result >= block_size) {
+        size_t len = (size - result) / block_size * block_size;
+        int n = readFile(content, content.pos, data + result, len);
+        if (n <= 0) break;
+        content.pos += n;
+        result += n;
+        if ((size_t)n < len) break;
+        continue;
+      }
+      uint32_t block_no = content.pos / block_size;
+      CacheBlock *p_block = cache.find(content.file_id, block_no);
+      if (p_block == nullptr) {
+        p_block = cache.allocate(content.file_id, block_no);
+        int n = readFile(content, block_no * block_size, p_block->data,
+                         block_size);
+        if (n <= 0) {
+          cache.release(*p_block);
+          break;
+        }
+        p_block->len = n;
+      }
+      if (offset >= p_block->len) break;
+      size_t len = p_block->len - offset;
+      if (len > size - result) len = size - result;
+      memcpy(data + result, p_block->data + offset, len);
+      content.pos += len;
+      result += len;
+      // end of file
+      if (p_block->len < block_size) break;
+    }
+    return result;
+  }
+
+  /// true if the open might have truncated the file
+  bool isTruncating(int flags) {
+    if (flags & O_TRUNC) return true;
+#ifdef FILE_MODE_STR
+    // "w" truncates the file
+    return flags & (O_WRONLY | O_RDWR);
+#else
+    return false;
+#endif
   }
 
 #ifdef FILE_MODE_STR
@@ -234,6 +797,7 @@ protected:
     } else if (flags & O_APPEND) {
       mstr = FILE_WRITE;
     }
+    return mstr;
   }
 #endif
 
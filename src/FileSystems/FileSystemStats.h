@@ -0,0 +1,174 @@
+#pragma once
+#include "ConfigFS.h"
+
+#if FS_STATS_ACTIVE
+#  include <stdint.h>
+#  include "FileSystems/Mutex.h"
+#  ifdef IS_DESKTOP
+#    include <chrono>
+#  else
+#    include "Arduino.h"
+#  endif
+
+namespace file_systems {
+
+/// Operations which are counted by the FileSystemStats
+enum FSOperation {
+  FSOpOpen,
+  FSOpClose,
+  FSOpRead,
+  FSOpWrite,
+  FSOpLseek,
+  FSOpStat,
+  FSOpOpendir,
+  FSOpReaddir,
+  FSOpUnlink,
+  FSOpFsync,
+  FSOpCount
+};
+
+/**
+ * @brief Statistics of one operation: bucket 0 of the histogram counts the
+ * calls below 1us and bucket n the calls from 2^(n-1) to 2^n - 1 us. The last
+ * bucket also contains all slower calls.
+ */
+struct FSOperationStats {
+  uint32_t calls = 0;
+  uint32_t errors = 0;
+  uint64_t bytes = 0;
+  uint64_t total_us = 0;
+  uint32_t histogram[FS_STATS_BUCKETS] = {0};
+
+  /// average latency in us
+  uint32_t averageUs() { return calls == 0 ? 0 : total_us / calls; }
+
+  /// upper bound of the latency in us which is not exceeded by the indicated
+  /// percentage of the calls (e.g. 99)
+  uint32_t percentileUs(int percent) {
+    if (calls == 0) return 0;
+    uint64_t limit = ((uint64_t)calls * percent + 99) / 100;
+    uint64_t sum = 0;
+    for (int j = 0; j < FS_STATS_BUCKETS; j++) {
+      sum += histogram[j];
+      if (sum >= limit) return 1ul << j;
+    }
+    return 1ul << (FS_STATS_BUCKETS - 1);
+  }
+};
+
+/// Copy of the statistics of all operations
+struct FSStatsSnapshot {
+  FSOperationStats op[FSOpCount];
+};
+
+/**
+ * @brief I/O statistics of a file system: the calls, bytes, errors and a
+ * log2 latency histogram per operation. The counters are updated w/o lock, so
+ * a snapshot which is taken while other tasks are active might be slightly
+ * inconsistent.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FileSystemStats {
+public:
+  /// Records a call which was started at startUs (see now()): negative
+  /// results are counted as errors, positive results of read and write as
+  /// bytes
+  void record(FSOperation op, long result, uint32_t startUs) {
+    uint32_t us = now() - startUs;
+    Counters &counters = ops[op];
+    counters.calls.add(1);
+    if (result < 0) {
+      counters.errors.add(1);
+    } else if (op == FSOpRead || op == FSOpWrite) {
+      counters.bytes.add(result);
+    }
+    counters.total_us.add(us);
+    counters.histogram[bucket(us)].add(1);
+  }
+
+  /// Provides a copy of the actual values
+  FSStatsSnapshot snapshot() {
+    FSStatsSnapshot result;
+    for (int j = 0; j < FSOpCount; j++) {
+      Counters &counters = ops[j];
+      FSOperationStats &stats = result.op[j];
+      stats.calls = counters.calls.load();
+      stats.errors = counters.errors.load();
+      stats.bytes = counters.bytes.load();
+      stats.total_us = counters.total_us.load();
+      for (int b = 0; b < FS_STATS_BUCKETS; b++) {
+        stats.histogram[b] = counters.histogram[b].load();
+      }
+    }
+    return result;
+  }
+
+  /// Sets all values to 0
+  void reset() {
+    for (int j = 0; j < FSOpCount; j++) {
+      Counters &counters = ops[j];
+      counters.calls.store(0);
+      counters.errors.store(0);
+      counters.bytes.store(0);
+      counters.total_us.store(0);
+      for (int b = 0; b < FS_STATS_BUCKETS; b++) {
+        counters.histogram[b].store(0);
+      }
+    }
+  }
+
+  /// Timestamp in us which is used to measure the latency
+  static uint32_t now() {
+#ifdef IS_DESKTOP
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#else
+    return micros();
+#endif
+  }
+
+  /// Name of the operation
+  static const char *name(FSOperation op) {
+    static const char *names[] = {"open",  "close", "read",
+                                  "write", "lseek", "stat",
+                                  "opendir", "readdir", "unlink",
+                                  "fsync"};
+    return op < FSOpCount ? names[op] : "?";
+  }
+
+  /// Histogram bucket for the latency: the number of significant bits
+  static int bucket(uint32_t us) {
+    int result = 0;
+    while (us != 0 && result < FS_STATS_BUCKETS - 1) {
+      us >>= 1;
+      result++;
+    }
+    return result;
+  }
+
+protected:
+  struct Counters {
+    AtomicCounter<uint32_t> calls;
+    AtomicCounter<uint32_t> errors;
+    AtomicCounter<uint64_t> bytes;
+    AtomicCounter<uint64_t> total_us;
+    AtomicCounter<uint32_t> histogram[FS_STATS_BUCKETS];
+  };
+  Counters ops[FSOpCount];
+};
+
+} // namespace file_systems
+
+#  define FS_STATS_START()                                                     \
+    uint32_t fs_stats_start = file_systems::FileSystemStats::now()
+#  define FS_STATS_RECORD(fs, op, result)                                      \
+    (fs).stats().record(op, (long)(result), fs_stats_start)
+
+#else
+
+#  define FS_STATS_START()
+#  define FS_STATS_RECORD(fs, op, result)
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+#include "Collections/Vector.h"
+#include "FileSystems/FileSystemBase.h"
+#include "LoggerFS.h"
+
+namespace file_systems {
+
+/**
+ * @brief Character trie of the mount path prefixes which resolves the file
+ * system for a path with a longest prefix match in a single pass over the
+ * path. The nodes are stored in a Vector and are linked by index.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MountTrie {
+public:
+  MountTrie() { nodes.push_back(Node()); }
+
+  /// Registers the file system for the path prefix: the first registration
+  /// for a prefix wins
+  bool add(const char *prefix, FileSystemBase *p_fs) {
+    if (prefix == nullptr || p_fs == nullptr) {
+      return false;
+    }
+    int idx = 0;
+    for (const char *p = prefix; *p != 0; p++) {
+      int child = findChild(idx, *p);
+      if (child < 0) {
+        Node node;
+        node.c = *p;
+        node.next_sibling = nodes[idx].first_child;
+        nodes.push_back(node);
+        child = nodes.size() - 1;
+        nodes[idx].first_child = child;
+      }
+      idx = child;
+    }
+    if (nodes[idx].p_fs != nullptr) {
+      FS_LOGW("MountTrie: prefix %s already used by %s", prefix,
+              nodes[idx].p_fs->name());
+      return false;
+    }
+    nodes[idx].p_fs = p_fs;
+    return true;
+  }
+
+  /// Provides the file system with the longest matching prefix which ends
+  /// at a / or at the end of the path or nullptr
+  FileSystemBase *find(const char *path) {
+    if (path == nullptr) {
+      return nullptr;
+    }
+    FileSystemBase *result = nodes[0].p_fs;
+    int idx = 0;
+    for (const char *p = path; *p != 0; p++) {
+      idx = findChild(idx, *p);
+      if (idx < 0) {
+        break;
+      }
+      // only match complete path components: /sd/cache is not a prefix of
+      // /sd/cachefoo
+      if (nodes[idx].p_fs != nullptr &&
+          (*p == '/' || p[1] == '/' || p[1] == 0)) {
+        result = nodes[idx].p_fs;
+      }
+    }
+    return result;
+  }
+
+protected:
+  struct Node {
+    char c = 0;
+    int first_child = -1;
+    int next_sibling = -1;
+    /// file system which is mounted at the path ending in this node
+    FileSystemBase *p_fs = nullptr;
+  };
+  Vector<Node, 8> nodes;
+
+  int findChild(int idx, char c) {
+    for (int child = nodes[idx].first_child; child >= 0;
+         child = nodes[child].next_sibling) {
+      if (nodes[child].c == c) {
+        return child;
+      }
+    }
+    return -1;
+  }
+};
+
+} // namespace file_systems
@@ -0,0 +1,164 @@
+#pragma once
+#include "ConfigFS.h"
+#if FS_THREAD_SAFE
+#  include <atomic>
+#  include <mutex>
+#endif
+
+namespace file_systems {
+
+/**
+ * @brief Recursive mutex which is used to protect the shared data structures.
+ * If FS_THREAD_SAFE is not active this is just an empty implementation.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class Mutex {
+public:
+  void lock() {
+#if FS_THREAD_SAFE
+    mtx.lock();
+#endif
+  }
+  void unlock() {
+#if FS_THREAD_SAFE
+    mtx.unlock();
+#endif
+  }
+
+protected:
+#if FS_THREAD_SAFE
+  std::recursive_mutex mtx;
+#endif
+};
+
+/**
+ * @brief Locks the mutex for the lifetime of the object
+ */
+class LockGuard {
+public:
+  LockGuard(Mutex &mutex) : mutex(mutex) { mutex.lock(); }
+  ~LockGuard() { mutex.unlock(); }
+  LockGuard(const LockGuard &) = delete;
+  LockGuard &operator=(const LockGuard &) = delete;
+
+protected:
+  Mutex &mutex;
+};
+
+/**
+ * @brief Pointer which is published with release and read with acquire
+ * semantics. If FS_THREAD_SAFE is not active this is just a regular pointer.
+ * @tparam T
+ */
+template <class T> class AtomicPtr {
+public:
+  T *load() {
+#if FS_THREAD_SAFE
+    return ptr.load(std::memory_order_acquire);
+#else
+    return ptr;
+#endif
+  }
+  void store(T *value) {
+#if FS_THREAD_SAFE
+    ptr.store(value, std::memory_order_release);
+#else
+    ptr = value;
+#endif
+  }
+
+protected:
+#if FS_THREAD_SAFE
+  std::atomic<T *> ptr{nullptr};
+#else
+  T *ptr = nullptr;
+#endif
+};
+
+/**
+ * @brief Value which is published with release and read with acquire
+ * semantics and which can be updated with compare and exchange. If
+ * FS_THREAD_SAFE is not active this is just a regular value.
+ * @tparam T
+ */
+template <class T> class AtomicValue {
+public:
+  T load() {
+#if FS_THREAD_SAFE
+    return value.load(std::memory_order_acquire);
+#else
+    return value;
+#endif
+  }
+  void store(T newValue) {
+#if FS_THREAD_SAFE
+    value.store(newValue, std::memory_order_release);
+#else
+    value = newValue;
+#endif
+  }
+  /// Replaces the value with desired if it is equal to expected: otherwise
+  /// expected is updated with the actual value
+  bool compareExchange(T &expected, T desired) {
+#if FS_THREAD_SAFE
+    return value.compare_exchange_weak(expected, desired,
+                                       std::memory_order_acq_rel,
+                                       std::memory_order_acquire);
+#else
+    if (value != expected) {
+      expected = value;
+      return false;
+    }
+    value = desired;
+    return true;
+#endif
+  }
+
+protected:
+#if FS_THREAD_SAFE
+  std::atomic<T> value{0};
+#else
+  T value = 0;
+#endif
+};
+
+/**
+ * @brief Counter which can be updated by different tasks w/o lock: the
+ * updates are relaxed because the value is only used for statistics. If
+ * FS_THREAD_SAFE is not active this is just a regular number.
+ * @tparam T
+ */
+template <class T> class AtomicCounter {
+public:
+  T load() {
+#if FS_THREAD_SAFE
+    return value.load(std::memory_order_relaxed);
+#else
+    return value;
+#endif
+  }
+  void add(T delta) {
+#if FS_THREAD_SAFE
+    value.fetch_add(delta, std::memory_order_relaxed);
+#else
+    value += delta;
+#endif
+  }
+  void store(T newValue) {
+#if FS_THREAD_SAFE
+    value.store(newValue, std::memory_order_relaxed);
+#else
+    value = newValue;
+#endif
+  }
+
+protected:
+#if FS_THREAD_SAFE
+  std::atomic<T> value{0};
+#else
+  T value = 0;
+#endif
+};
+
+} // namespace file_systems
@@ -1,9 +1,14 @@
 #pragma once
+#include <stdlib.h>
+#include "Collections/ObjectPool.h"
 #include "Collections/Queue.h"
-#include "Collections/Str.h"
+#include "Collections/PathView.h"
 #include "Collections/Vector.h"
 #include "ConfigFS.h"
+#include "FileSystems/FDTable.h"
 #include "FileSystems/FileSystemBase.h"
+#include "FileSystems/MountTrie.h"
+#include "FileSystems/Mutex.h"
 #include "LoggerFS.h"
 
 namespace file_systems {
@@ -32,6 +37,7 @@ struct DIR_BASE : public DIR {
  * @copyright GPLv3
  */
 struct RegContent {
+  virtual ~RegContent() = default;
   RegContentType id = ContentUndefined;
 };
 
@@ -57,17 +63,17 @@ struct RegEntry {
       file_name = nullptr;
     }
   }
-  int memory_guard = 12345;
   /// reference to the file system
   FileSystemBase *p_file_system = nullptr;
   /// the name of the file
   const char *file_name = nullptr;
-  /// true if file_name was allocated and must be freed
-  bool file_name_owned = false;
   /// pointer to specific content object
   RegContent *content = nullptr;
   /// index in the vector of open files
   int fileID = 0; // index pos in open_files vector
+  int memory_guard = 12345;
+  /// true if file_name was allocated and must be freed
+  bool file_name_owned = false;
   /// returns true when the content is defined
   virtual operator bool() { return content != nullptr; }
 };
@@ -78,7 +84,10 @@ static RegEntry NoRegEntry;
 static FileSystemBase NoFileSystem("/null");
 
 /**
- * @brief Registry which manages open files
+ * @brief Registry which manages open files. All updates are serialized with a
+ * mutex, while the lookup of open files by fd is lock free. As with posix, an
+ * fd must not be closed while another thread is still using it: the entry is
+ * reused by the next open.
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
@@ -89,7 +98,9 @@ public:
   /// Registers the file system
   void add(FileSystemBase &fileSystem) {
     FS_TRACED();
+    LockGuard guard(mutex);
     file_systems.push_back(&fileSystem);
+    mounts.add(fileSystem.pathPrefix(), &fileSystem);
   }
 
   /// opens a new file and provides the corresponding file descriptor
@@ -106,33 +117,44 @@ public:
   /// opens a new file and provides the corresponding file descriptor
   RegEntry &openFile(const char *path, FileSystemBase &fs) {
     FS_TRACED();
-    RegEntry *new_entry = new RegEntry();
+    LockGuard guard(mutex);
+    RegEntry *new_entry = entry_pool.create();
+    if (new_entry == nullptr) {
+      FS_LOGE("openFile: no free entry for %s", path);
+      return NoRegEntry;
+    }
     new_entry->p_file_system = &fs;
     new_entry->file_name = path;
 
     int idx = findOpenEmpty();
-
-    if (idx >= 0) {
-      // replace nullptr with entry
-      new_entry->fileID = idx;
-      open_files[idx] = new_entry;
-    } else {
+    if (idx < 0) {
       // add new entry at end
-      new_entry->fileID = size();
-      open_files.push_back(new_entry);
+      idx = size();
+    }
+    new_entry->fileID = idx;
+    // publish the fully initialized entry
+    if (!open_files.set(idx, new_entry)) {
+      FS_LOGE("openFile: too many open files for %s", path);
+      entry_pool.release(new_entry);
+      return NoRegEntry;
+    }
+    open_count++;
+    if (open_count > high_water_mark) {
+      high_water_mark = open_count;
     }
-    FS_LOGD("=> total open files %d", size());
+    FS_LOGD("=> total open files %d", open_count);
     return *new_entry;
   }
 
-  /// Determines the file system for a file path
+  /// Determines the file system for a file path: if the mount prefixes are
+  /// nested we use the longest matching prefix
   FileSystemBase &fileSystem(const char *path) {
     FS_LOGD("fileSystem(%s)", path);
-    for (auto p_fs : file_systems) {
-      if (p_fs->FileSystemBase::isValidFile(path)) {
-        FS_LOGD("-> %s", p_fs->name());
-        return *p_fs;
-      }
+    LockGuard guard(mutex);
+    FileSystemBase *p_fs = mounts.find(path);
+    if (p_fs != nullptr) {
+      FS_LOGD("-> %s", p_fs->name());
+      return *p_fs;
     }
     FS_LOGE("No filesystem for %s", path);
     return NoFileSystem;
@@ -151,28 +173,49 @@ public:
   /// closes the file at the indicated idx
   void closeFile(RegEntry &entry) { closeFile(entry.fileID); }
 
-  /// closes the file at the indicated idx
+  /// closes the file at the indicated idx: the entry goes back to the pool
+  /// immediately, so no other thread may still use the fd
   void closeFile(int fileID) {
     FS_TRACED();
-    RegEntry *p_entry = open_files[fileID];
-    if (p_entry != nullptr) {
-      delete p_entry;
-      open_files[fileID] = nullptr;
+    LockGuard guard(mutex);
+    RegEntry *p_entry = open_files.get(fileID);
+    if (p_entry == nullptr) {
+      FS_LOGE("closeFile: invalid fileID %d", fileID);
+      return;
     }
+    open_files.set(fileID, nullptr);
+    entry_pool.release(p_entry);
+    // last released fd is reused first
+    free_ids.push_back(fileID);
+    open_count--;
   }
 
-  /// Returns the File by fd
+  /// Returns the File by fd: lock free
   RegEntry &getEntry(int fileID) {
-    if ((size_t)fileID < size()) {
-      return *open_files[fileID];
+    RegEntry *p_entry = open_files.get(fileID);
+    if (p_entry != nullptr) {
+      return *p_entry;
     }
     FS_LOGE("fileSystem: No Regentry for %d", fileID);
     return NoRegEntry;
   }
 
-  /// Reurns the number of file entries
+  /// Reurns the number of file entries (including the closed ones)
   size_t size() { return open_files.size(); }
 
+  /// Returns the number of actually open files
+  size_t openCount() { return open_count; }
+
+  /// Returns the max number of files which were open at the same time
+  size_t highWaterMark() { return high_water_mark; }
+
+  /// Defines the number of preallocated open file entries: must be called
+  /// before any file is opened
+  bool setPoolSize(int size, bool heapFallback = true) {
+    LockGuard guard(mutex);
+    return entry_pool.setCapacity(size, heapFallback);
+  }
+
   /// Defines the actual file system that is used for directory searches
   void setFileSystemForSearch(FileSystemBase *fs) { search_file_system = fs; }
 
@@ -182,8 +225,9 @@ public:
   /// Determines the file system by name
   FileSystemBase &fileSystemByName(const char *path) {
     FS_TRACED();
+    LockGuard guard(mutex);
     for (auto p_fs : file_systems) {
-      if (Str(p_fs->name()).equals(path)) {
+      if (PathView(path).equals(p_fs->name())) {
         return *p_fs;
       }
     }
@@ -203,22 +247,30 @@ public:
 
 protected:
   FileSystemBase *search_file_system;
-  // Shared vector for all open files
-  Vector<RegEntry *> open_files;
+  // Serializes all updates
+  Mutex mutex;
+  // Shared table for all open files
+  FDTable open_files;
   // Shared vector for all file systems
-  Vector<FileSystemBase *> file_systems;
+  Vector<FileSystemBase *, 4> file_systems;
+  // Path prefixes of all file systems
+  MountTrie mounts;
+
+  // Preallocated entries for open files
+  ObjectPool<RegEntry> entry_pool{FS_OPEN_FILES_POOL_SIZE};
+  // Released fileIDs which can be reused (used as LIFO stack)
+  Vector<int, 8> free_ids;
+  size_t open_count = 0;
+  size_t high_water_mark = 0;
 
   // Finds an empty stop in the open files list
   int findOpenEmpty() {
     FS_TRACED();
-    int result = -1;
-    for (size_t j = 0; j < size(); j++) {
-      RegEntry *entry = open_files[j];
-      if (entry == nullptr) {
-        result = j;
-        break;
-      }
+    if (free_ids.empty()) {
+      return -1;
     }
+    int result = free_ids.back();
+    free_ids.pop_back();
     return result;
   }
 };
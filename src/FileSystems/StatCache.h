@@ -0,0 +1,146 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Collections/IntrusiveList.h"
+#include "Collections/PathView.h"
+
+namespace file_systems {
+
+/**
+ * @brief Result of a stat: we also keep the paths which do not exist
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct StatInfo {
+  bool exists = false;
+  bool is_dir = false;
+  size_t size = 0;
+};
+
+/**
+ * @brief Cached StatInfo of a path
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct StatCacheEntry : public IntrusiveListNode<StatCacheEntry> {
+  /// copy of the path: nullptr if the entry is not used
+  char *path = nullptr;
+  uint32_t hash = 0;
+  StatInfo info;
+};
+
+/**
+ * @brief Bounded LRU cache which maps a path to its StatInfo: the owner needs
+ * to invalidate the paths which are changed. The lookup is a linear search
+ * which compares the hashes first.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class StatCache {
+public:
+  StatCache() = default;
+  StatCache(const StatCache &) = delete;
+  StatCache &operator=(const StatCache &) = delete;
+  ~StatCache() { end(); }
+
+  /// Allocates count entries: 0 deactivates the cache
+  bool begin(int count) {
+    end();
+    if (count <= 0) return true;
+    p_entries = new StatCacheEntry[count];
+    if (p_entries == nullptr) return false;
+    entry_count = count;
+    for (int j = 0; j < count; j++) {
+      lru.push_back(p_entries[j]);
+    }
+    return true;
+  }
+
+  /// Releases the memory
+  void end() {
+    clear();
+    lru.clear();
+    delete[] p_entries;
+    p_entries = nullptr;
+    entry_count = 0;
+  }
+
+  bool isActive() { return entry_count > 0; }
+
+  /// Provides the cached info of the path
+  bool get(const char *path, StatInfo &info) {
+    StatCacheEntry *p_entry = find(path, PathView(path).hash());
+    if (p_entry == nullptr) {
+      miss_count++;
+      return false;
+    }
+    lru.moveToFront(*p_entry);
+    hit_count++;
+    info = p_entry->info;
+    return true;
+  }
+
+  /// Adds or updates the info of the path: the least recently used entry is
+  /// replaced
+  void put(const char *path, const StatInfo &info) {
+    if (!isActive()) return;
+    uint32_t hash = PathView(path).hash();
+    StatCacheEntry *p_entry = find(path, hash);
+    if (p_entry == nullptr) {
+      p_entry = lru.back();
+      free(p_entry->path);
+      p_entry->path = strdup(path);
+      p_entry->hash = hash;
+      if (p_entry->path == nullptr) return;
+    }
+    p_entry->info = info;
+    lru.moveToFront(*p_entry);
+  }
+
+  /// Drops the info of the path
+  void invalidate(const char *path) {
+    if (!isActive()) return;
+    StatCacheEntry *p_entry = find(path, PathView(path).hash());
+    if (p_entry != nullptr) release(*p_entry);
+  }
+
+  /// Drops all entries
+  void clear() {
+    for (int j = 0; j < entry_count; j++) {
+      if (p_entries[j].path != nullptr) release(p_entries[j]);
+    }
+  }
+
+  /// Number of get() calls which found the path
+  uint32_t hits() { return hit_count; }
+
+  /// Number of get() calls which did not find the path
+  uint32_t misses() { return miss_count; }
+
+protected:
+  IntrusiveList<StatCacheEntry> lru;
+  StatCacheEntry *p_entries = nullptr;
+  int entry_count = 0;
+  uint32_t hit_count = 0;
+  uint32_t miss_count = 0;
+
+  StatCacheEntry *find(const char *path, uint32_t hash) {
+    for (auto &entry : lru) {
+      // unused entries are at the end
+      if (entry.path == nullptr) break;
+      if (entry.hash == hash && strcmp(entry.path, path) == 0) return &entry;
+    }
+    return nullptr;
+  }
+
+  void release(StatCacheEntry &entry) {
+    free(entry.path);
+    entry.path = nullptr;
+    lru.remove(entry);
+    lru.push_back(entry);
+  }
+};
+
+} // namespace file_systems
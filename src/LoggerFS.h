@@ -10,6 +10,7 @@
 #  undef B1000000
 #endif
 #include "Arduino.h"
+#include "LoggerFSDeferred.h"
 
 namespace file_systems {
 
@@ -34,14 +35,60 @@ public:
   /// Print log message
   void log(FSLogLevel_t level, const char *fmt...) {
     if (logLevel <= level) { // AUDIOKIT_LOG_LEVEL = Debug
-      char log_buffer[200];
-      strcpy(log_buffer, FS_log_msg[level]);
-      strcat(log_buffer, ":     ");
       va_list arg;
       va_start(arg, fmt);
-      vsprintf(log_buffer + 9, fmt, arg);
+      if (p_buffer != nullptr) {
+        p_buffer->add(level, micros(), fmt, arg);
+      } else {
+        char log_buffer[200];
+        strcpy(log_buffer, FS_log_msg[level]);
+        strcat(log_buffer, ":     ");
+        vsprintf(log_buffer + 9, fmt, arg);
+        p_out->println(log_buffer);
+      }
       va_end(arg);
-      p_out->println(log_buffer);
+    }
+  }
+
+  /// Deferred logging: the messages are only stored in a ring buffer of
+  /// size entries (rounded up to a power of 2) and they are formatted and
+  /// printed by flush(). Returns false for a size of 0. This should not be
+  /// changed while other tasks are logging.
+  bool setDeferred(bool active, size_t size = FS_LOG_BUFFER_SIZE) {
+    if (p_buffer != nullptr) {
+      flush();
+      delete p_buffer;
+      p_buffer = nullptr;
+    }
+    if (!active) return true;
+    p_buffer = new FSLogBuffer(size);
+    if (p_buffer == nullptr || !*p_buffer) {
+      delete p_buffer;
+      p_buffer = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  /// Prints the deferred messages: this must not be called by different
+  /// tasks at the same time
+  void flush() {
+    if (p_buffer == nullptr) return;
+    char msg[200];
+    char prefix[30];
+    uint8_t level;
+    uint32_t timestamp;
+    while (p_buffer->format(msg, sizeof(msg), level, timestamp)) {
+      snprintf(prefix, sizeof(prefix), "%-8s %lu: ", FS_log_msg[level],
+               (unsigned long)timestamp);
+      p_out->print(prefix);
+      p_out->println(msg);
+    }
+    uint32_t dropped = p_buffer->dropped();
+    if (dropped > 0) {
+      snprintf(msg, sizeof(msg), "Warning: %lu log messages dropped",
+               (unsigned long)dropped);
+      p_out->println(msg);
     }
   }
 
@@ -49,27 +96,43 @@ protected:
   // Error level as string
   const char *FS_log_msg[4] = {"Debug", "Info", "Warning", "Error"};
   Print *p_out = &FS_LOG_PORT;
+  FSLogBuffer *p_buffer = nullptr;
 };
 
 extern FSLoggerClass FSLogger;
 
 } // namespace arduino_FS
 
+#endif
+
+// Log calls below FS_LOG_MIN_LEVEL are removed by the preprocessor, so
+// their arguments are not evaluated
+#if FS_LOGGING_ACTIVE && FS_LOG_MIN_LEVEL <= 0
 #  define FS_LOGD(fmt, ...) file_systems::FSLogger.log(FSDebug, fmt, ##__VA_ARGS__)
-#  define FS_LOGI(fmt, ...) file_systems::FSLogger.log(FSInfo, fmt, ##__VA_ARGS__)
-#  define FS_LOGW(fmt, ...) file_systems::FSLogger.log(FSWarning, fmt, ##__VA_ARGS__)
-#  define FS_LOGE(fmt, ...) file_systems::FSLogger.log(FSError, fmt, ##__VA_ARGS__)
 #  define FS_TRACED() file_systems::FSLogger.log(FSDebug, LOG_METHOD)
+#else
+#  define FS_LOGD(fmt, ...)
+#  define FS_TRACED()
+#endif
+
+#if FS_LOGGING_ACTIVE && FS_LOG_MIN_LEVEL <= 1
+#  define FS_LOGI(fmt, ...) file_systems::FSLogger.log(FSInfo, fmt, ##__VA_ARGS__)
 #  define FS_TRACEI() file_systems::FSLogger.log(FSInfo, LOG_METHOD)
-#  define FS_TRACEE() file_systems::FSLogger.log(FSError, LOG_METHOD)
+#else
+#  define FS_LOGI(fmt, ...)
+#  define FS_TRACEI()
+#endif
 
+#if FS_LOGGING_ACTIVE && FS_LOG_MIN_LEVEL <= 2
+#  define FS_LOGW(fmt, ...) file_systems::FSLogger.log(FSWarning, fmt, ##__VA_ARGS__)
 #else
-#  define FS_LOGD(fmt, ...) 
-#  define FS_LOGI(fmt, ...) 
-#  define FS_LOGW(fmt, ...) 
-#  define FS_LOGE(fmt, ...) 
-#  define FS_TRACED() 
-#  define FS_TRACEI() 
-#  define FS_TRACEE() 
+#  define FS_LOGW(fmt, ...)
 #endif
 
+#if FS_LOGGING_ACTIVE && FS_LOG_MIN_LEVEL <= 3
+#  define FS_LOGE(fmt, ...) file_systems::FSLogger.log(FSError, fmt, ##__VA_ARGS__)
+#  define FS_TRACEE() file_systems::FSLogger.log(FSError, LOG_METHOD)
+#else
+#  define FS_LOGE(fmt, ...)
+#  define FS_TRACEE()
+#endif
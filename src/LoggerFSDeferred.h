@@ -0,0 +1,378 @@
+#pragma once
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "ConfigFS.h"
+#include "FileSystems/Mutex.h"
+
+namespace file_systems {
+
+/// Raw argument of a deferred log message
+union FSLogArg {
+  long long i;
+  double d;
+  const void *p;
+};
+
+/**
+ * @brief Log message which has not been formatted yet: %s arguments are
+ * copied into text because they might not be valid any more when the message
+ * is formatted.
+ */
+struct FSLogRecord {
+  AtomicValue<uint32_t> seq;
+  const char *fmt;
+  uint32_t timestamp;
+  uint8_t level;
+  uint8_t arg_count;
+  FSLogArg args[FS_LOG_DEFERRED_ARGS];
+  char text[FS_LOG_DEFERRED_TEXT];
+};
+
+/**
+ * @brief Lock free ring buffer of log messages: any number of tasks can add
+ * messages, while only one task is formatting them. The caller only copies
+ * the format pointer, the timestamp and the raw arguments, so logging does
+ * not need to wait for the output. If the buffer is full the message is
+ * dropped and counted.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FSLogBuffer {
+public:
+  /// The capacity is rounded up to the next power of 2: 0 is invalid
+  FSLogBuffer(size_t capacity) {
+    if (capacity == 0 || capacity > 0x80000000UL) return;
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    records = new FSLogRecord[size];
+    if (records == nullptr) return;
+    mask = size - 1;
+    for (size_t j = 0; j < size; j++) {
+      records[j].seq.store(j);
+    }
+  }
+  FSLogBuffer(const FSLogBuffer &) = delete;
+  FSLogBuffer &operator=(const FSLogBuffer &) = delete;
+
+  ~FSLogBuffer() { delete[] records; }
+
+  operator bool() { return records != nullptr; }
+
+  /// Records the message: returns false if the buffer is full
+  bool add(uint8_t level, uint32_t timestamp, const char *fmt, va_list arg) {
+    uint32_t pos;
+    FSLogRecord *record = reserve(pos);
+    if (record == nullptr) {
+      dropped_count.add(1);
+      return false;
+    }
+    record->fmt = fmt;
+    record->timestamp = timestamp;
+    record->level = level;
+    va_list args;
+    va_copy(args, arg);
+    capture(*record, &args);
+    va_end(args);
+    // publish the record for the reader
+    record->seq.store(pos + 1);
+    return true;
+  }
+
+  /// Formats the oldest message: returns false if there is none. Must only
+  /// be called by one task at a time.
+  bool format(char *buffer, size_t len, uint8_t &level, uint32_t &timestamp) {
+    FSLogRecord &record = records[read_pos & mask];
+    if (record.seq.load() != read_pos + 1) return false;
+    level = record.level;
+    timestamp = record.timestamp;
+    formatRecord(record, buffer, len);
+    // release the slot for the writers
+    record.seq.store(read_pos + mask + 1);
+    read_pos++;
+    return true;
+  }
+
+  /// Number of messages which were dropped because the buffer was full:
+  /// the counter is reset
+  uint32_t dropped() {
+    uint32_t result = dropped_count.load();
+    dropped_count.store(0);
+    return result;
+  }
+
+protected:
+  FSLogRecord *records = nullptr;
+  size_t mask = 0;
+  AtomicValue<uint32_t> write_pos;
+  AtomicCounter<uint32_t> dropped_count;
+  uint32_t read_pos = 0;
+
+  // claims the next free slot
+  FSLogRecord *reserve(uint32_t &pos) {
+    pos = write_pos.load();
+    while (true) {
+      FSLogRecord &record = records[pos & mask];
+      int32_t diff = (int32_t)(record.seq.load() - pos);
+      if (diff < 0) return nullptr;
+      if (diff == 0 && write_pos.compareExchange(pos, pos + 1)) {
+        return &record;
+      }
+      if (diff > 0) pos = write_pos.load();
+    }
+  }
+
+  /// Copies the arguments which are defined by the format string
+  static void capture(FSLogRecord &record, va_list *arg) {
+    record.arg_count = 0;
+    size_t text_pos = 0;
+    for (const char *p = record.fmt; *p != 0; p++) {
+      if (*p != '%') continue;
+      Spec spec;
+      p = parse(p + 1, spec);
+      if (spec.conversion == 0) break;
+      if (spec.conversion == '%') continue;
+      if (record.arg_count + spec.star_count + 1 > FS_LOG_DEFERRED_ARGS) break;
+      // width and precision with *
+      for (int j = 0; j < spec.star_count; j++) {
+        record.args[record.arg_count++].i = va_arg(*arg, int);
+      }
+      FSLogArg &value = record.args[record.arg_count++];
+      switch (spec.type) {
+      case TypeSigned:
+        value.i = getSigned(spec.length, arg);
+        break;
+      case TypeUnsigned:
+        value.i = (long long)getUnsigned(spec.length, arg);
+        break;
+      case TypeDouble:
+        value.d = va_arg(*arg, double);
+        break;
+      case TypeString: {
+        const char *str = va_arg(*arg, const char *);
+        if (str == nullptr) str = "(null)";
+        size_t len = strlen(str);
+        if (len > FS_LOG_DEFERRED_TEXT - 1 - text_pos) {
+          len = FS_LOG_DEFERRED_TEXT - 1 - text_pos;
+        }
+        memcpy(record.text + text_pos, str, len);
+        record.text[text_pos + len] = 0;
+        value.i = text_pos;
+        text_pos += len;
+        if (text_pos + 1 < FS_LOG_DEFERRED_TEXT) text_pos++;
+        break;
+      }
+      default:
+        value.p = va_arg(*arg, const void *);
+        break;
+      }
+    }
+  }
+
+  /// Formats the message with the recorded arguments
+  void formatRecord(FSLogRecord &record, char *buffer, size_t len) {
+    size_t pos = 0;
+    int arg_idx = 0;
+    buffer[0] = 0;
+    for (const char *p = record.fmt; *p != 0 && pos + 1 < len;) {
+      if (*p != '%') {
+        buffer[pos++] = *p++;
+        buffer[pos] = 0;
+        continue;
+      }
+      Spec spec;
+      const char *end = parse(p + 1, spec);
+      if (spec.conversion == '%') {
+        buffer[pos++] = '%';
+        buffer[pos] = 0;
+        p = end + 1;
+        continue;
+      }
+      if (spec.conversion == 0 ||
+          arg_idx + spec.star_count + 1 > record.arg_count) {
+        break;
+      }
+      // rebuild the conversion w/o * and with the type of the stored value
+      char conv[32];
+      int conv_len = snprintf(conv, sizeof(conv), "%%%.*s", spec.flags_len,
+                              spec.flags);
+      if (spec.width_star) {
+        conv_len += snprintf(conv + conv_len, sizeof(conv) - conv_len, "%d",
+                             (int)record.args[arg_idx++].i);
+      } else {
+        conv_len += snprintf(conv + conv_len, sizeof(conv) - conv_len, "%.*s",
+                             spec.width_len, spec.width);
+      }
+      if (spec.has_precision) {
+        if (spec.precision_star) {
+          conv_len += snprintf(conv + conv_len, sizeof(conv) - conv_len, ".%d",
+                               (int)record.args[arg_idx++].i);
+        } else {
+          conv_len += snprintf(conv + conv_len, sizeof(conv) - conv_len,
+                               ".%.*s", spec.precision_len, spec.precision);
+        }
+      }
+      bool is_int = spec.type == TypeSigned || spec.type == TypeUnsigned;
+      snprintf(conv + conv_len, sizeof(conv) - conv_len, "%s%c",
+               is_int && spec.conversion != 'c' ? "ll" : "", spec.conversion);
+
+      FSLogArg &value = record.args[arg_idx++];
+      int n = 0;
+      switch (spec.type) {
+      case TypeSigned:
+      case TypeUnsigned:
+        if (spec.conversion == 'c') {
+          n = snprintf(buffer + pos, len - pos, conv, (int)value.i);
+        } else {
+          n = snprintf(buffer + pos, len - pos, conv, value.i);
+        }
+        break;
+      case TypeDouble:
+        n = snprintf(buffer + pos, len - pos, conv, value.d);
+        break;
+      case TypeString:
+        n = snprintf(buffer + pos, len - pos, conv, record.text + value.i);
+        break;
+      default:
+        n = snprintf(buffer + pos, len - pos, conv, value.p);
+        break;
+      }
+      if (n < 0) break;
+      pos += n;
+      if (pos >= len) {
+        pos = len - 1;
+        break;
+      }
+      p = end + 1;
+    }
+    buffer[pos] = 0;
+  }
+
+  enum ArgType { TypeSigned, TypeUnsigned, TypeDouble, TypeString, TypePointer };
+
+  /// parsed printf conversion specification
+  struct Spec {
+    const char *flags = nullptr;
+    int flags_len = 0;
+    const char *width = nullptr;
+    int width_len = 0;
+    bool width_star = false;
+    const char *precision = nullptr;
+    int precision_len = 0;
+    bool has_precision = false;
+    bool precision_star = false;
+    int star_count = 0;
+    // l, ll, h, hh, z, j, t
+    char length[3] = {0};
+    char conversion = 0;
+    ArgType type = TypePointer;
+  };
+
+  // parses the specification after the %: returns the pointer to the
+  // conversion character
+  static const char *parse(const char *p, Spec &spec) {
+    spec.flags = p;
+    while (*p != 0 && strchr("-+ #0", *p) != nullptr) p++;
+    spec.flags_len = p - spec.flags;
+    spec.width = p;
+    if (*p == '*') {
+      spec.width_star = true;
+      spec.star_count++;
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9') p++;
+    }
+    spec.width_len = p - spec.width;
+    if (*p == '.') {
+      spec.has_precision = true;
+      p++;
+      spec.precision = p;
+      if (*p == '*') {
+        spec.precision_star = true;
+        spec.star_count++;
+        p++;
+      } else {
+        while (*p >= '0' && *p <= '9') p++;
+      }
+      spec.precision_len = p - spec.precision;
+    }
+    int length_len = 0;
+    while (*p != 0 && strchr("hlzjt", *p) != nullptr) {
+      if (length_len < 2) spec.length[length_len++] = *p;
+      p++;
+    }
+    spec.conversion = *p;
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'c':
+      spec.type = TypeSigned;
+      break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      spec.type = TypeUnsigned;
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      spec.type = TypeDouble;
+      break;
+    case 's':
+      spec.type = TypeString;
+      break;
+    case 'p':
+    case '%':
+      spec.type = TypePointer;
+      break;
+    default:
+      // unsupported conversion (e.g. %n or %Lf)
+      spec.conversion = 0;
+      return p;
+    }
+    return p;
+  }
+
+  static long long getSigned(const char *length, va_list *arg) {
+    if (length[0] == 'l' && length[1] == 'l') return va_arg(*arg, long long);
+    switch (length[0]) {
+    case 'l':
+      return va_arg(*arg, long);
+    case 'z':
+      return (long long)va_arg(*arg, size_t);
+    case 'j':
+      return va_arg(*arg, intmax_t);
+    case 't':
+      return va_arg(*arg, ptrdiff_t);
+    default:
+      return va_arg(*arg, int);
+    }
+  }
+
+  static unsigned long long getUnsigned(const char *length, va_list *arg) {
+    if (length[0] == 'l' && length[1] == 'l')
+      return va_arg(*arg, unsigned long long);
+    switch (length[0]) {
+    case 'l':
+      return va_arg(*arg, unsigned long);
+    case 'z':
+      return va_arg(*arg, size_t);
+    case 'j':
+      return va_arg(*arg, uintmax_t);
+    case 't':
+      return (unsigned long long)va_arg(*arg, ptrdiff_t);
+    default:
+      return va_arg(*arg, unsigned int);
+    }
+  }
+};
+
+} // namespace file_systems
@@ -0,0 +1,89 @@
+/**
+ * @brief Compares the read throughput of compressed in memory files with the
+ * plain (memmove based) reads, so that you can decide per file if the
+ * compression is worth it.
+ */
+#include <chrono>
+#include <vector>
+#include "FileSystems.h"
+#include "../fs-pack/Packer.h"
+
+using namespace file_systems;
+
+static const size_t file_size = 1024 * 1024;
+static const int repeat = 20;
+
+// text like test data which compresses similar to html or json
+static std::vector<uint8_t> testData() {
+  const char *words[] = {"<div class=\"item\">", "</div>", "value", "name",
+                         "{\"id\": ", "\"title\": ", "lorem", "ipsum", " ",
+                         "\n"};
+  std::vector<uint8_t> result;
+  uint32_t seed = 1;
+  while (result.size() < file_size) {
+    seed = seed * 1103515245 + 12345;
+    const char *word = words[(seed >> 16) % 10];
+    result.insert(result.end(), word, word + strlen(word));
+  }
+  result.resize(file_size);
+  return result;
+}
+
+// reads the whole file sequentially with the indicated buffer size
+static double readAll(const char *path, size_t bufferSize) {
+  std::vector<uint8_t> buffer(bufferSize);
+  auto start = std::chrono::steady_clock::now();
+  size_t total = 0;
+  for (int j = 0; j < repeat; j++) {
+    int fd = open(path, O_RDONLY);
+    int n;
+    while ((n = read(fd, buffer.data(), bufferSize)) > 0) {
+      total += n;
+    }
+    close(fd);
+  }
+  std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+  return total / sec.count() / 1000000.0;
+}
+
+// reads small records at random positions
+static double readRandom(const char *path, size_t recordSize) {
+  std::vector<uint8_t> buffer(recordSize);
+  int fd = open(path, O_RDONLY);
+  uint32_t seed = 7;
+  int count = 20000;
+  auto start = std::chrono::steady_clock::now();
+  for (int j = 0; j < count; j++) {
+    seed = seed * 1103515245 + 12345;
+    lseek(fd, seed % (file_size - recordSize), SEEK_SET);
+    read(fd, buffer.data(), recordSize);
+  }
+  std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+  close(fd);
+  return count / sec.count();
+}
+
+int main() {
+  FileSystemMemory fs("/mem");
+  std::vector<uint8_t> data = testData();
+  fs.add("/mem/raw", data.data(), data.size());
+
+  printf("%-10s %10s %8s %14s %14s %14s\n", "block", "packed", "ratio",
+         "seq MB/s", "seq-4k MB/s", "random op/s");
+  printf("%-10s %10zu %8.2f %14.1f %14.1f %14.0f\n", "raw", data.size(), 1.0,
+         readAll("/mem/raw", 512), readAll("/mem/raw", 4096),
+         readRandom("/mem/raw", 64));
+
+  std::vector<std::vector<uint8_t>> packed;
+  for (uint32_t block_size : {256, 1024, 4096}) {
+    packed.push_back(packCompressed(data.data(), data.size(), block_size));
+    std::vector<uint8_t> &p = packed.back();
+    char path[40];
+    snprintf(path, sizeof(path), "/mem/lz4-%u", (unsigned)block_size);
+    fs.addCompressed(path, p.data(), p.size());
+    printf("lz4-%-6u %10zu %8.2f %14.1f %14.1f %14.0f\n",
+           (unsigned)block_size, p.size(), (double)data.size() / p.size(),
+           readAll(path, 512), readAll(path, 4096), readRandom(path, 64));
+  }
+  return 0;
+}
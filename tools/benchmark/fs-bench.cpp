@@ -0,0 +1,301 @@
+/**
+ * @brief Benchmarks for the FileSystemMemory with different file counts and
+ * file sizes. The results are written as CSV (default) or JSON, so that they
+ * can be compared across releases. open-read is also measured with several
+ * threads which read the same files, to show how the registry scales:
+ *
+ *   fs-bench [--json] [--output file] [--max-files n] [--max-size n]
+ *            [--min-time ms] [--max-threads n]
+ */
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FileSystems.h"
+
+using namespace file_systems;
+
+/// Result of one benchmark run
+struct Result {
+  const char *name;
+  size_t files;
+  size_t file_size;
+  int threads;
+  uint64_t ops;
+  uint64_t bytes;
+  double seconds;
+};
+
+/// Number of operations and bytes of one round
+struct Round {
+  uint64_t ops;
+  uint64_t bytes;
+};
+
+static const size_t file_counts[] = {10, 100, 1000, 10000, 100000};
+static const size_t file_sizes[] = {16, 256, 4096, 65536, 1 << 20, 16 << 20};
+// files per directory
+static const size_t dir_size = 100;
+// max bytes which are read in one round
+static const size_t read_budget = 64 << 20;
+
+static size_t max_files = 100000;
+static size_t max_size = 16 << 20;
+static double min_time = 0.2;
+static int max_threads = 8;
+static std::vector<Result> results;
+// lines of 40 characters which are used as content of all files
+static std::vector<uint8_t> content;
+
+// repeats the round until min_time has passed
+template <class Fn>
+static void measure(const char *name, size_t files, size_t fileSize, Fn fn) {
+  Result result{name, files, fileSize, 1, 0, 0, 0};
+  auto start = std::chrono::steady_clock::now();
+  do {
+    Round round = fn();
+    result.ops += round.ops;
+    result.bytes += round.bytes;
+    std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+    result.seconds = sec.count();
+  } while (result.seconds < min_time);
+  results.push_back(result);
+  fprintf(stderr, "%-14s files=%-7zu size=%-9zu %12.0f ops/s\n", name, files,
+          fileSize, result.ops / result.seconds);
+}
+
+static std::string filePath(const char *prefix, size_t idx) {
+  char path[80];
+  snprintf(path, sizeof(path), "%s/d%zu/f%zu.txt", prefix, idx / dir_size, idx);
+  return path;
+}
+
+// registers the files with the indicated size
+static void addFiles(FileSystemMemory &fs, const char *prefix, size_t count,
+                     size_t fileSize) {
+  for (size_t j = 0; j < count; j++) {
+    fs.add(filePath(prefix, j).c_str(), content.data(), fileSize);
+  }
+}
+
+static void benchAdd(size_t count) {
+  int run = 0;
+  measure("add", count, 16, [&]() {
+    // every round needs a new file system: the registry keeps a reference
+    char prefix[40];
+    snprintf(prefix, sizeof(prefix), "/add%zu-%d", count, run++);
+    FileSystemMemory *p_fs = new FileSystemMemory(strdup(prefix));
+    addFiles(*p_fs, prefix, count, 16);
+    return Round{count, 0};
+  });
+}
+
+static void benchStat(const char *prefix, size_t count) {
+  std::vector<std::string> hits, misses;
+  for (size_t j = 0; j < count; j++) {
+    hits.push_back(filePath(prefix, j));
+    misses.push_back(filePath(prefix, j) + ".missing");
+  }
+  struct stat st;
+  measure("stat-hit", count, 0, [&]() {
+    for (auto &path : hits) stat(path.c_str(), &st);
+    return Round{count, 0};
+  });
+  measure("stat-miss", count, 0, [&]() {
+    for (auto &path : misses) stat(path.c_str(), &st);
+    return Round{count, 0};
+  });
+}
+
+static void benchReaddir(const char *prefix, size_t count) {
+  measure("readdir", count, 0, [&]() {
+    uint64_t ops = 0;
+    DIR *root = opendir(prefix);
+    dirent *entry;
+    std::vector<std::string> dirs;
+    while ((entry = readdir(root)) != nullptr) {
+      dirs.push_back(std::string(prefix) + "/" + entry->d_name);
+      ops++;
+    }
+    closedir(root);
+    for (auto &dir : dirs) {
+      DIR *p_dir = opendir(dir.c_str());
+      while (readdir(p_dir) != nullptr) ops++;
+      closedir(p_dir);
+    }
+    return Round{ops, 0};
+  });
+}
+
+// number of files which are processed in one round
+static size_t filesPerRound(size_t count, size_t fileSize) {
+  size_t result = read_budget / fileSize;
+  return result == 0 ? 1 : (result > count ? count : result);
+}
+
+static void benchRead(const char *prefix, size_t count, size_t fileSize) {
+  std::vector<uint8_t> buffer(4096);
+  size_t files = filesPerRound(count, fileSize);
+  measure("open-read", count, fileSize, [&]() {
+    uint64_t bytes = 0;
+    for (size_t j = 0; j < files; j++) {
+      int fd = open(filePath(prefix, j).c_str(), O_RDONLY);
+      int n;
+      while ((n = read(fd, buffer.data(), buffer.size())) > 0) bytes += n;
+      close(fd);
+    }
+    return Round{files, bytes};
+  });
+}
+
+// open/read/close with the indicated number of threads for min_time
+static void benchThreads(const char *prefix, size_t count, size_t fileSize,
+                         int threads) {
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> ops{0}, bytes{0}, errors{0};
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      std::vector<uint8_t> buffer(4096);
+      uint64_t thread_ops = 0, thread_bytes = 0;
+      for (size_t j = t; !stop.load(std::memory_order_relaxed); j += threads) {
+        int fd = open(filePath(prefix, j % count).c_str(), O_RDONLY);
+        if (fd < 0) {
+          errors++;
+          continue;
+        }
+        int n;
+        while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+          thread_bytes += n;
+        }
+        close(fd);
+        thread_ops++;
+      }
+      ops += thread_ops;
+      bytes += thread_bytes;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(min_time));
+  stop = true;
+  for (auto &worker : workers) worker.join();
+  std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+  Result result{"open-read-mt", count, fileSize, threads, ops, bytes,
+                sec.count()};
+  results.push_back(result);
+  fprintf(stderr, "%-14s files=%-7zu size=%-9zu %12.0f ops/s threads=%d%s\n",
+          result.name, count, fileSize, result.ops / result.seconds, threads,
+          errors > 0 ? " (open failed)" : "");
+}
+
+static void benchFgets(const char *prefix, size_t count, size_t fileSize) {
+  char line[128];
+  size_t files = filesPerRound(count, fileSize);
+  measure("fgets", count, fileSize, [&]() {
+    uint64_t ops = 0, bytes = 0;
+    for (size_t j = 0; j < files; j++) {
+      FILE *fp = fopen(filePath(prefix, j).c_str(), "r");
+      while (fgets(line, sizeof(line), fp) != nullptr) {
+        ops++;
+        bytes += strlen(line);
+      }
+      fclose(fp);
+    }
+    return Round{ops, bytes};
+  });
+}
+
+static void write(bool json) {
+  printf(json ? "[\n"
+              : "benchmark,files,file_size,threads,ops,bytes,seconds,ops_per_s,"
+                "ns_per_op,bytes_per_s\n");
+  for (size_t j = 0; j < results.size(); j++) {
+    Result &r = results[j];
+    double ops_per_s = r.ops / r.seconds;
+    double ns_per_op = r.seconds * 1e9 / r.ops;
+    double bytes_per_s = r.bytes / r.seconds;
+    if (!json) {
+      printf("%s,%zu,%zu,%d,%llu,%llu,%.6f,%.1f,%.1f,%.1f\n", r.name,
+             r.files, r.file_size, r.threads, (unsigned long long)r.ops,
+             (unsigned long long)r.bytes, r.seconds, ops_per_s, ns_per_op,
+             bytes_per_s);
+    } else {
+      printf("  {\"benchmark\": \"%s\", \"files\": %zu, \"file_size\": %zu, "
+             "\"threads\": %d, \"ops\": %llu, \"bytes\": %llu, \"seconds\": %.6f, "
+             "\"ops_per_s\": %.1f, \"ns_per_op\": %.1f, \"bytes_per_s\": "
+             "%.1f}%s\n",
+             r.name, r.files, r.file_size, r.threads, (unsigned long long)r.ops,
+             (unsigned long long)r.bytes, r.seconds, ops_per_s, ns_per_op,
+             bytes_per_s, j + 1 < results.size() ? "," : "");
+    }
+  }
+  if (json) printf("]\n");
+}
+
+int main(int argc, char *argv[]) {
+  bool json = false;
+  const char *output = nullptr;
+  for (int j = 1; j < argc; j++) {
+    if (strcmp(argv[j], "--json") == 0) {
+      json = true;
+    } else if (strcmp(argv[j], "--output") == 0 && j + 1 < argc) {
+      output = argv[++j];
+    } else if (strcmp(argv[j], "--max-files") == 0 && j + 1 < argc) {
+      max_files = atol(argv[++j]);
+    } else if (strcmp(argv[j], "--max-size") == 0 && j + 1 < argc) {
+      max_size = atol(argv[++j]);
+    } else if (strcmp(argv[j], "--min-time") == 0 && j + 1 < argc) {
+      min_time = atol(argv[++j]) / 1000.0;
+    } else if (strcmp(argv[j], "--max-threads") == 0 && j + 1 < argc) {
+      max_threads = atol(argv[++j]);
+    } else {
+      fprintf(stderr,
+              "usage: fs-bench [--json] [--output file] [--max-files n] "
+              "[--max-size n] [--min-time ms] [--max-threads n]\n");
+      return 1;
+    }
+  }
+
+  content.resize(max_size);
+  for (size_t j = 0; j < content.size(); j++) {
+    content[j] = j % 40 == 39 ? '\n' : 'a' + j % 26;
+  }
+
+  for (size_t count : file_counts) {
+    if (count > max_files) break;
+    char *prefix = (char *)malloc(20);
+    snprintf(prefix, 20, "/bench%zu", count);
+    FileSystemMemory *p_fs = new FileSystemMemory(prefix);
+    addFiles(*p_fs, prefix, count, 16);
+
+    benchAdd(count);
+    benchStat(prefix, count);
+    benchReaddir(prefix, count);
+    for (size_t size : file_sizes) {
+      if (size > max_size) break;
+      // updates the size of the existing files
+      addFiles(*p_fs, prefix, count, size);
+      benchRead(prefix, count, size);
+      benchFgets(prefix, count, size);
+    }
+  }
+
+  // scaling of open-read with several threads
+  size_t mt_files = max_files < 1000 ? max_files : 1000;
+  size_t mt_size = max_size < 4096 ? max_size : 4096;
+  FileSystemMemory *p_mt = new FileSystemMemory("/mt");
+  addFiles(*p_mt, "/mt", mt_files, mt_size);
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    benchThreads("/mt", mt_files, mt_size, threads);
+  }
+
+  // fopen is mapped to the registered file systems, freopen is not
+  if (output != nullptr && freopen(output, "w", stdout) == nullptr) {
+    fprintf(stderr, "fs-bench: could not create %s\n", output);
+    return 1;
+  }
+  write(json);
+  return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * @brief Benchmark of the FileSystemSD against the host stand-in of the SD
+ * library (tools/sd-host): the throughput is calculated with the measured
+ * time plus the emulated card time, so that the effect of the caches becomes
+ * visible. The reads are measured with and without the read cache, the
+ * writes with and without the write buffer, stat with and without the
+ * stat cache and the directory listing with and without the dir cache.
+ *
+ *   sd-bench [--image card.img] [--call-us n] [--sector-us n] [--blocks n]
+ */
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "FileSystems.h"
+#include "FileSystems/FileSystemSD.h"
+
+using namespace file_systems;
+
+static const size_t file_size = 1024 * 1024;
+static const char *file_path = "/sd/bench.dat";
+static int cache_blocks = FS_SD_CACHE_BLOCKS;
+static const int dir_entries = 2000;
+
+/// Measured time and emulated card costs of one run
+struct Run {
+  std::chrono::steady_clock::time_point start;
+  uint64_t sector_reads;
+  uint64_t sector_writes;
+
+  Run() {
+    SD.resetCounters();
+    start = std::chrono::steady_clock::now();
+  }
+
+  /// measured seconds plus the emulated card time
+  double seconds() {
+    std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+    sector_reads = SD.sectorReads();
+    sector_writes = SD.sectorWrites();
+    return sec.count() + SD.busyMicros() / 1000000.0;
+  }
+};
+
+static void print(const char *name, bool active, double seconds, double ops,
+                  double bytes, Run &run) {
+  printf("%-12s %-6s %12.0f %10.2f %14llu %14llu\n", name, active ? "on" : "off",
+         ops / seconds, bytes / seconds / 1000000.0,
+         (unsigned long long)run.sector_reads,
+         (unsigned long long)run.sector_writes);
+}
+
+// reads the whole file sequentially with the indicated record size
+static void readSequential(bool cache, size_t recordSize) {
+  std::vector<uint8_t> buffer(recordSize);
+  Run run;
+  int fd = open(file_path, O_RDONLY);
+  size_t total = 0;
+  int n;
+  while ((n = read(fd, buffer.data(), recordSize)) > 0) {
+    total += n;
+  }
+  close(fd);
+  double sec = run.seconds();
+  char name[40];
+  snprintf(name, sizeof(name), "seq-%zu", recordSize);
+  print(name, cache, sec, total / recordSize, total, run);
+}
+
+// reads small records at random positions in the first 16k (e.g. headers)
+static void readRandom(bool cache, size_t recordSize) {
+  std::vector<uint8_t> buffer(recordSize);
+  Run run;
+  int fd = open(file_path, O_RDONLY);
+  uint32_t seed = 7;
+  int count = 20000;
+  for (int j = 0; j < count; j++) {
+    seed = seed * 1103515245 + 12345;
+    lseek(fd, (seed >> 8) % (16384 - recordSize), SEEK_SET);
+    read(fd, buffer.data(), recordSize);
+  }
+  close(fd);
+  double sec = run.seconds();
+  char name[40];
+  snprintf(name, sizeof(name), "random-%zu", recordSize);
+  print(name, cache, sec, count, count * recordSize, run);
+}
+
+// appends records of the indicated size (e.g. sensor data)
+static void writeLog(bool buffer, size_t recordSize) {
+  std::vector<uint8_t> record(recordSize, 'x');
+  record[recordSize - 1] = '\n';
+  SD.remove("/log.txt");
+  Run run;
+  int fd = open("/sd/log.txt", O_WRONLY | O_CREAT | O_APPEND);
+  size_t count = 256 * 1024 / recordSize;
+  for (size_t j = 0; j < count; j++) {
+    write(fd, record.data(), recordSize);
+  }
+  close(fd);
+  double sec = run.seconds();
+  char name[40];
+  snprintf(name, sizeof(name), "log-%zu", recordSize);
+  print(name, buffer, sec, count, count * recordSize, run);
+}
+
+// stats the same path (e.g. the files of a web server)
+static void statPath(bool cache, const char *name, const char *path) {
+  Run run;
+  int count = 20000;
+  struct stat st;
+  for (int j = 0; j < count; j++) {
+    stat(path, &st);
+  }
+  double sec = run.seconds();
+  print(name, cache, sec, count, 0, run);
+}
+
+// lists a directory with many files (e.g. a playlist of audio files)
+static void listDir(bool cache) {
+  Run run;
+  int count = 20;
+  size_t entries = 0;
+  for (int j = 0; j < count; j++) {
+    DIR *dir = opendir("/sd/audio");
+    while (readdir(dir) != nullptr) {
+      entries++;
+    }
+    closedir(dir);
+  }
+  double sec = run.seconds();
+  print("readdir", cache, sec, entries, 0, run);
+}
+
+int main(int argc, char *argv[]) {
+  const char *image = nullptr;
+  uint32_t call_us = 20;
+  uint32_t sector_us = 250;
+  for (int j = 1; j < argc; j++) {
+    if (strcmp(argv[j], "--image") == 0 && j + 1 < argc) {
+      image = argv[++j];
+    } else if (strcmp(argv[j], "--call-us") == 0 && j + 1 < argc) {
+      call_us = atol(argv[++j]);
+    } else if (strcmp(argv[j], "--sector-us") == 0 && j + 1 < argc) {
+      sector_us = atol(argv[++j]);
+    } else if (strcmp(argv[j], "--blocks") == 0 && j + 1 < argc) {
+      cache_blocks = atol(argv[++j]);
+    } else {
+      fprintf(stderr, "usage: sd-bench [--image card.img] [--call-us n] "
+                      "[--sector-us n] [--blocks n]\n");
+      return 1;
+    }
+  }
+
+  if (image != nullptr && !SD.loadImage(image)) {
+    fprintf(stderr, "sd-bench: could not load %s\n", image);
+    return 1;
+  }
+  SD.begin();
+  FileSystemSD fs("/sd", SD);
+  File file = SD.open("/bench.dat", FILE_WRITE);
+  for (size_t j = 0; j < file_size; j++) {
+    file.write((uint8_t)(j % 40 == 39 ? '\n' : 'a' + j % 26));
+  }
+  file.close();
+  SD.mkdir("/audio");
+  for (int j = 0; j < dir_entries; j++) {
+    char path[40];
+    snprintf(path, sizeof(path), "/audio/track%04d.mp3", j);
+    SD.open(path, FILE_WRITE).close();
+  }
+  SD.setLatency(call_us, sector_us);
+
+  printf("card: call %u us, sector %u us, cache %d x %d bytes, write buffer "
+         "%d bytes\n", (unsigned)call_us, (unsigned)sector_us, cache_blocks,
+         FS_SD_CACHE_BLOCK_SIZE, FS_SD_WRITE_BUFFER_SIZE);
+  printf("%-12s %-6s %12s %10s %14s %14s\n", "benchmark", "active", "ops/s",
+         "MB/s", "sector-reads", "sector-writes");
+  for (bool cache : {false, true}) {
+    fs.setCacheSize(cache ? cache_blocks : 0);
+    for (size_t size : {16, 64, 512, 4096}) {
+      readSequential(cache, size);
+    }
+    readRandom(cache, 64);
+  }
+  for (bool cache : {false, true}) {
+    fs.setStatCacheSize(cache ? FS_SD_STAT_CACHE_SIZE : 0);
+    statPath(cache, "stat-hit", file_path);
+    statPath(cache, "stat-miss", "/sd/missing/index.html");
+  }
+  for (bool cache : {false, true}) {
+    fs.setDirCacheSize(cache ? FS_SD_DIR_CACHE_SIZE : 0);
+    listDir(cache);
+  }
+  for (bool buffer : {false, true}) {
+    fs.setWriteBufferSize(buffer ? FS_SD_WRITE_BUFFER_SIZE : 0);
+    for (size_t size : {32, 128}) {
+      writeLog(buffer, size);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * @brief Packs all files of a directory tree into c source code which can be
+ * mounted with FileSystemMemory::mount():
+ *
+ *   fs-image directory variable-name [output.h]
+ *
+ * The generated header contains a sorted constexpr FileImage table and the
+ * data of all files in one contiguous array, which is stored in PROGMEM on
+ * Arduino.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct File {
+  std::string name;
+  fs::path path;
+};
+
+// escapes the file name for a c string literal
+static std::string quote(const std::string &str) {
+  std::string result = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') result += '\\';
+    result += c;
+  }
+  return result + "\"";
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr, "usage: fs-image directory variable-name [output.h]\n");
+    return 1;
+  }
+  fs::path dir = argv[1];
+  std::string name = argv[2];
+  if (!fs::is_directory(dir)) {
+    fprintf(stderr, "fs-image: %s is not a directory\n", argv[1]);
+    return 1;
+  }
+  FILE *out = argc == 4 ? fopen(argv[3], "w") : stdout;
+  if (out == nullptr) {
+    fprintf(stderr, "fs-image: could not create %s\n", argv[3]);
+    return 1;
+  }
+
+  // the names are relative to the directory with / as separator
+  std::vector<File> files;
+  for (auto &entry : fs::recursive_directory_iterator(dir)) {
+    if (entry.is_regular_file()) {
+      files.push_back({entry.path().lexically_relative(dir).generic_string(),
+                       entry.path()});
+    }
+  }
+  // the lookup is a binary search with strcmp
+  std::sort(files.begin(), files.end(), [](const File &a, const File &b) {
+    return strcmp(a.name.c_str(), b.name.c_str()) < 0;
+  });
+
+  fprintf(out, "// generated by fs-image from %s\n", argv[1]);
+  fprintf(out, "#pragma once\n#include \"FileSystems/FileImage.h\"\n\n");
+  fprintf(out, "#ifdef ARDUINO\n#  include <Arduino.h>\n");
+  fprintf(out, "const unsigned char %s_data[] PROGMEM = {\n#else\n",
+          name.c_str());
+  fprintf(out, "const unsigned char %s_data[] = {\n#endif", name.c_str());
+  std::vector<size_t> offsets;
+  size_t total = 0;
+  for (File &file : files) {
+    offsets.push_back(total);
+    FILE *in = fopen(file.path.string().c_str(), "rb");
+    if (in == nullptr) {
+      fprintf(stderr, "fs-image: could not open %s\n", file.path.c_str());
+      return 1;
+    }
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+      fprintf(out, "%s0x%02x,", total % 12 == 0 ? "\n  " : " ", c);
+      total++;
+    }
+    fclose(in);
+  }
+  // arrays must not be empty
+  if (total == 0) fprintf(out, "0");
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out, "constexpr file_systems::ImageEntry %s_entries[] = {\n",
+          name.c_str());
+  for (size_t j = 0; j < files.size(); j++) {
+    size_t end = j + 1 < files.size() ? offsets[j + 1] : total;
+    fprintf(out, "  {%s, %zu, %zu},\n", quote(files[j].name).c_str(),
+            offsets[j], end - offsets[j]);
+  }
+  if (files.empty()) fprintf(out, "  {nullptr, 0, 0},\n");
+  fprintf(out, "};\n\n");
+
+  fprintf(out,
+          "constexpr file_systems::FileImage %s = {%s_entries, %zu, "
+          "%s_data};\n",
+          name.c_str(), name.c_str(), files.size(), name.c_str());
+  if (out != stdout) fclose(out);
+  fprintf(stderr, "fs-image: %zu files with %zu bytes\n", files.size(), total);
+  return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include "Compression/CompressedBlocks.h"
+
+namespace file_systems {
+
+/**
+ * @brief Host side creation of the CompressedBlocks format which can be
+ * registered with FileSystemMemory::addCompressed()
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+inline std::vector<uint8_t> packCompressed(const uint8_t *data, size_t len,
+                                           uint32_t blockSize) {
+  CompressedHeader header;
+  memcpy(header.magic, FS_COMPRESSED_MAGIC, 4);
+  header.block_size = blockSize;
+  header.size = len;
+  header.block_count = (len + blockSize - 1) / blockSize;
+
+  std::vector<uint32_t> index;
+  std::vector<uint8_t> blocks;
+  std::vector<uint8_t> tmp(lz4CompressBound(blockSize));
+  for (size_t pos = 0; pos < len; pos += blockSize) {
+    size_t block_len = len - pos < blockSize ? len - pos : blockSize;
+    index.push_back(blocks.size());
+    int compressed_len =
+        lz4CompressBlock(data + pos, block_len, tmp.data(), tmp.size());
+    // blocks which do not get smaller are stored w/o compression
+    if (compressed_len < 0 || (size_t)compressed_len >= block_len) {
+      blocks.insert(blocks.end(), data + pos, data + pos + block_len);
+    } else {
+      blocks.insert(blocks.end(), tmp.data(), tmp.data() + compressed_len);
+    }
+  }
+  index.push_back(blocks.size());
+
+  std::vector<uint8_t> result((uint8_t *)&header,
+                              (uint8_t *)&header + sizeof(header));
+  result.insert(result.end(), (uint8_t *)index.data(),
+                (uint8_t *)(index.data() + index.size()));
+  result.insert(result.end(), blocks.begin(), blocks.end());
+  return result;
+}
+
+} // namespace file_systems
@@ -0,0 +1,59 @@
+/**
+ * @brief Converts a file into c source code with compressed content which can
+ * be registered with FileSystemMemory::addCompressed():
+ *
+ *   fs-pack [-b block_size] input-file variable-name > output.h
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Packer.h"
+
+using namespace file_systems;
+
+static int usage() {
+  fprintf(stderr, "usage: fs-pack [-b block_size] input-file variable-name\n");
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t block_size = 1024;
+  int arg = 1;
+  if (argc > 2 && strcmp(argv[1], "-b") == 0) {
+    block_size = atoi(argv[2]);
+    arg = 3;
+  }
+  if (argc - arg != 2 || block_size == 0) {
+    return usage();
+  }
+  const char *path = argv[arg];
+  const char *name = argv[arg + 1];
+
+  FILE *in = fopen(path, "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "fs-pack: could not open %s\n", path);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+    data.insert(data.end(), buffer, buffer + n);
+  }
+  fclose(in);
+
+  std::vector<uint8_t> packed =
+      packCompressed(data.data(), data.size(), block_size);
+
+  printf("// %s: %zu bytes compressed to %zu bytes (block size %u)\n", path,
+         data.size(), packed.size(), (unsigned)block_size);
+  printf("const unsigned char %s[] = {", name);
+  for (size_t j = 0; j < packed.size(); j++) {
+    printf("%s0x%02x", j % 12 == 0 ? "\n  " : " ", packed[j]);
+    if (j + 1 < packed.size()) printf(",");
+  }
+  printf("\n};\n");
+  printf("const unsigned int %s_len = %zu;\n", name, packed.size());
+  return 0;
+}
@@ -0,0 +1,423 @@
+#pragma once
+/**
+ * @brief Host stand-in for the Arduino SD library, so that FileSystemSD can
+ * be tested and benchmarked on the desktop. The card content is kept in RAM:
+ * it can be loaded from and saved to a regular image file in tar (ustar)
+ * format, e.g. created with "tar cf card.img -C dir .".
+ *
+ * The card itself is emulated with a simple cost model: each call which
+ * accesses the card costs the call time, each transferred sector the sector
+ * time. Like SdFat we keep the last sector in a cache, writes are written
+ * through. The costs are not waited for, they are only added up (see
+ * SDClass::busyMicros()) together with the number of sector transfers.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// we need the real stdio functions for the image file
+#pragma push_macro("fopen")
+#pragma push_macro("fread")
+#pragma push_macro("fclose")
+#undef fopen
+#undef fread
+#undef fclose
+#include <stdio.h>
+
+#define FILE_READ 0x01
+#define FILE_WRITE 0x0F
+#define SD_HOST_MODE_WRITE 0x02
+#define SD_HOST_MODE_CREATE 0x04
+#define SD_HOST_MODE_APPEND 0x08
+#define SD_HOST_SECTOR_SIZE 512
+
+class SDClass;
+
+namespace sd_host {
+
+/// File or directory on the emulated card
+struct Entry {
+  bool is_dir = false;
+  std::vector<uint8_t> data;
+};
+
+/// Parameters and counters of the cost model
+struct Card {
+  uint32_t call_us = 0;
+  uint32_t sector_us = 0;
+  uint64_t calls = 0;
+  uint64_t sector_reads = 0;
+  uint64_t sector_writes = 0;
+  uint64_t busy_us = 0;
+  // sector in the cache of the card library
+  const Entry *p_cached = nullptr;
+  size_t cached_sector = 0;
+
+  void call() {
+    calls++;
+    busy_us += call_us;
+  }
+
+  void readSector(const Entry *p_entry, size_t sector) {
+    if (p_entry == p_cached && sector == cached_sector) return;
+    sector_reads++;
+    busy_us += sector_us;
+    p_cached = p_entry;
+    cached_sector = sector;
+  }
+
+  /// reads a sector of a directory: these are not cached
+  void readDirectory() {
+    sector_reads++;
+    busy_us += sector_us;
+    p_cached = nullptr;
+  }
+
+  void writeSector(const Entry *p_entry, size_t sector) {
+    sector_writes++;
+    busy_us += sector_us;
+    p_cached = p_entry;
+    cached_sector = sector;
+  }
+
+  /// accesses the sectors of len bytes at pos
+  void transfer(const Entry *p_entry, size_t pos, size_t len, bool write) {
+    if (len == 0) return;
+    size_t first = pos / SD_HOST_SECTOR_SIZE;
+    size_t last = (pos + len - 1) / SD_HOST_SECTOR_SIZE;
+    for (size_t sector = first; sector <= last; sector++) {
+      if (!write) {
+        readSector(p_entry, sector);
+        continue;
+      }
+      size_t start = sector * SD_HOST_SECTOR_SIZE;
+      bool partial = pos > start || pos + len < start + SD_HOST_SECTOR_SIZE;
+      // read modify write of a partial sector
+      if (partial && start < p_entry->data.size()) readSector(p_entry, sector);
+      writeSector(p_entry, sector);
+    }
+  }
+};
+
+} // namespace sd_host
+
+/**
+ * @brief File on the emulated card with the API of the Arduino SD library
+ */
+class File {
+public:
+  File() = default;
+
+  int read() {
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+  }
+
+  int read(void *buffer, size_t len) {
+    if (!p_entry || p_entry->is_dir) return -1;
+    p_card->call();
+    size_t size = p_entry->data.size();
+    if (pos >= size) return 0;
+    if (len > size - pos) len = size - pos;
+    p_card->transfer(p_entry.get(), pos, len, false);
+    memcpy(buffer, p_entry->data.data() + pos, len);
+    pos += len;
+    return len;
+  }
+
+  size_t write(uint8_t value) { return write(&value, 1); }
+
+  size_t write(const uint8_t *data, size_t len) {
+    if (!p_entry || p_entry->is_dir || !(mode & SD_HOST_MODE_WRITE)) return 0;
+    p_card->call();
+    if (mode & SD_HOST_MODE_APPEND) pos = p_entry->data.size();
+    p_card->transfer(p_entry.get(), pos, len, true);
+    if (pos + len > p_entry->data.size()) p_entry->data.resize(pos + len);
+    memcpy(p_entry->data.data() + pos, data, len);
+    pos += len;
+    return len;
+  }
+
+  bool seek(uint32_t newPos) {
+    if (!p_entry || newPos > p_entry->data.size()) return false;
+    pos = newPos;
+    return true;
+  }
+
+  uint32_t position() { return pos; }
+
+  uint32_t size() { return p_entry ? p_entry->data.size() : 0; }
+
+  int available() { return size() - pos; }
+
+  void flush() {}
+
+  void close() { p_entry.reset(); }
+
+  bool isDirectory() { return p_entry && p_entry->is_dir; }
+
+  /// name w/o directory
+  const char *name() {
+    size_t idx = path.rfind('/');
+    return path.c_str() + (idx == std::string::npos ? 0 : idx + 1);
+  }
+
+  operator bool() { return p_entry != nullptr; }
+
+  /// next entry of the directory
+  File openNextFile(uint8_t mode = FILE_READ);
+
+  void rewindDirectory() {
+    last_child.clear();
+    dir_idx = 0;
+  }
+
+protected:
+  friend class SDClass;
+  SDClass *p_sd = nullptr;
+  sd_host::Card *p_card = nullptr;
+  std::shared_ptr<sd_host::Entry> p_entry;
+  std::string path;
+  size_t pos = 0;
+  uint8_t mode = FILE_READ;
+  // last entry provided by openNextFile()
+  std::string last_child;
+  size_t dir_idx = 0;
+};
+
+/**
+ * @brief Emulated card with the API of the Arduino SD library
+ */
+class SDClass {
+public:
+  SDClass() { entries["/"] = dir(); }
+
+  bool begin(uint8_t csPin = 0) { return true; }
+
+  void end() {}
+
+  File open(const char *filepath, uint8_t mode = FILE_READ) {
+    std::string path = normalize(filepath);
+    lookup(path);
+    return openEntry(path, mode);
+  }
+
+  bool exists(const char *filepath) {
+    std::string path = normalize(filepath);
+    lookup(path);
+    return entries.count(path) > 0;
+  }
+
+  bool remove(const char *filepath) {
+    std::string path = normalize(filepath);
+    lookup(path);
+    auto it = entries.find(path);
+    if (it == entries.end() || it->second->is_dir) return false;
+    entries.erase(it);
+    return true;
+  }
+
+  /// creates the directory and the missing parent directories
+  bool mkdir(const char *filepath) {
+    std::string path = normalize(filepath);
+    size_t idx = 0;
+    do {
+      idx = path.find('/', idx + 1);
+      std::string part = path.substr(0, idx);
+      if (entries.count(part) == 0) entries[part] = dir();
+    } while (idx != std::string::npos);
+    return isDir(path);
+  }
+
+  bool rmdir(const char *filepath) {
+    std::string path = normalize(filepath);
+    if (!isDir(path) || path == "/" || nextChild(path, "") != entries.end()) {
+      return false;
+    }
+    entries.erase(path);
+    return true;
+  }
+
+  // ---- host only ----
+
+  /// Defines the emulated costs of a call and of a sector transfer in us
+  void setLatency(uint32_t callUs, uint32_t sectorUs) {
+    card.call_us = callUs;
+    card.sector_us = sectorUs;
+  }
+
+  /// Resets the counters
+  void resetCounters() {
+    card.calls = card.sector_reads = card.sector_writes = card.busy_us = 0;
+  }
+
+  uint64_t calls() { return card.calls; }
+  uint64_t sectorReads() { return card.sector_reads; }
+  uint64_t sectorWrites() { return card.sector_writes; }
+  /// Sum of the emulated costs in us
+  uint64_t busyMicros() { return card.busy_us; }
+
+  /// Adds the content of a tar (ustar) image file
+  bool loadImage(const char *imagePath) {
+    FILE *p_file = fopen(imagePath, "rb");
+    if (p_file == nullptr) return false;
+    uint8_t header[SD_HOST_SECTOR_SIZE];
+    bool result = false;
+    while (fread(header, 1, sizeof(header), p_file) == sizeof(header)) {
+      if (header[0] == 0) {
+        result = true;
+        break;
+      }
+      std::string name((const char *)header, strnlen((const char *)header, 100));
+      if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != 0) {
+        name = std::string((const char *)header + 345,
+                           strnlen((const char *)header + 345, 155)) + "/" + name;
+      }
+      size_t size = strtoul(std::string((const char *)header + 124, 12).c_str(),
+                            nullptr, 8);
+      char type = header[156];
+      std::string path = normalize(name.c_str());
+      mkdir(type == '5' ? path.c_str() : parent(path).c_str());
+      std::vector<uint8_t> data((size + SD_HOST_SECTOR_SIZE - 1) /
+                                SD_HOST_SECTOR_SIZE * SD_HOST_SECTOR_SIZE);
+      if (fread(data.data(), 1, data.size(), p_file) != data.size()) break;
+      if (type == '0' || type == 0) {
+        auto p_entry = std::make_shared<sd_host::Entry>();
+        p_entry->data.assign(data.begin(), data.begin() + size);
+        entries[path] = p_entry;
+      }
+    }
+    fclose(p_file);
+    return result;
+  }
+
+  /// Writes the content as tar (ustar) image file
+  bool saveImage(const char *imagePath) {
+    FILE *p_file = fopen(imagePath, "wb");
+    if (p_file == nullptr) return false;
+    bool result = true;
+    for (auto &it : entries) {
+      if (it.first == "/") continue;
+      std::string name = it.first.substr(1) + (it.second->is_dir ? "/" : "");
+      if (name.size() > 99) {
+        fprintf(stderr, "saveImage: name too long: %s\n", name.c_str());
+        result = false;
+        continue;
+      }
+      uint8_t header[SD_HOST_SECTOR_SIZE] = {0};
+      size_t size = it.second->data.size();
+      memcpy(header, name.c_str(), name.size());
+      snprintf((char *)header + 100, 8, "%07o", it.second->is_dir ? 0755 : 0644);
+      snprintf((char *)header + 108, 8, "%07o", 0);
+      snprintf((char *)header + 116, 8, "%07o", 0);
+      snprintf((char *)header + 124, 12, "%011lo", (unsigned long)size);
+      snprintf((char *)header + 136, 12, "%011o", 0);
+      header[156] = it.second->is_dir ? '5' : '0';
+      memcpy(header + 257, "ustar", 6);
+      memcpy(header + 263, "00", 2);
+      memset(header + 148, ' ', 8);
+      unsigned checksum = 0;
+      for (uint8_t value : header) checksum += value;
+      snprintf((char *)header + 148, 8, "%06o", checksum);
+      fwrite(header, 1, sizeof(header), p_file);
+      fwrite(it.second->data.data(), 1, size, p_file);
+      static const uint8_t padding[SD_HOST_SECTOR_SIZE] = {0};
+      fwrite(padding, 1, (SD_HOST_SECTOR_SIZE - size % SD_HOST_SECTOR_SIZE) %
+                             SD_HOST_SECTOR_SIZE, p_file);
+    }
+    static const uint8_t end_blocks[2 * SD_HOST_SECTOR_SIZE] = {0};
+    fwrite(end_blocks, 1, sizeof(end_blocks), p_file);
+    fclose(p_file);
+    return result;
+  }
+
+protected:
+  friend class File;
+  std::map<std::string, std::shared_ptr<sd_host::Entry>> entries;
+  sd_host::Card card;
+
+  static std::shared_ptr<sd_host::Entry> dir() {
+    auto result = std::make_shared<sd_host::Entry>();
+    result->is_dir = true;
+    return result;
+  }
+
+  /// path with leading and w/o trailing /
+  static std::string normalize(const char *filepath) {
+    std::string result = filepath;
+    while (result.rfind("./", 0) == 0) result = result.substr(2);
+    if (result.empty() || result[0] != '/') result = "/" + result;
+    while (result.size() > 1 && result.back() == '/') result.pop_back();
+    return result;
+  }
+
+  static std::string parent(const std::string &path) {
+    size_t idx = path.rfind('/');
+    return idx == 0 ? "/" : path.substr(0, idx);
+  }
+
+  bool isDir(const std::string &path) {
+    auto it = entries.find(path);
+    return it != entries.end() && it->second->is_dir;
+  }
+
+  /// a directory sector is read for each path component
+  void lookup(const std::string &path) {
+    card.call();
+    for (char c : path) {
+      if (c == '/') card.readDirectory();
+    }
+  }
+
+  File openEntry(const std::string &path, uint8_t mode) {
+    File result;
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+      if (!(mode & SD_HOST_MODE_CREATE) || !isDir(parent(path))) {
+        return result;
+      }
+      it = entries.emplace(path, std::make_shared<sd_host::Entry>()).first;
+    }
+    result.p_sd = this;
+    result.p_card = &card;
+    result.p_entry = it->second;
+    result.path = path;
+    result.mode = mode;
+    if (mode & SD_HOST_MODE_APPEND) result.pos = it->second->data.size();
+    return result;
+  }
+
+  /// direct child of the directory after last
+  std::map<std::string, std::shared_ptr<sd_host::Entry>>::iterator
+  nextChild(const std::string &dirPath, const std::string &last) {
+    std::string prefix = dirPath == "/" ? "/" : dirPath + "/";
+    auto it = last.empty() ? entries.upper_bound(prefix)
+                           : entries.upper_bound(last);
+    for (; it != entries.end() && it->first.rfind(prefix, 0) == 0; ++it) {
+      if (it->first.find('/', prefix.size()) == std::string::npos) return it;
+    }
+    return entries.end();
+  }
+};
+
+inline File File::openNextFile(uint8_t mode) {
+  File result;
+  if (!isDirectory()) return result;
+  p_card->call();
+  auto it = p_sd->nextChild(path, last_child);
+  if (it == p_sd->entries.end()) return result;
+  // 16 directory entries per sector
+  if (dir_idx++ % 16 == 0) p_card->readDirectory();
+  last_child = it->first;
+  return p_sd->openEntry(it->first, mode);
+}
+
+inline SDClass SD;
+
+#pragma pop_macro("fclose")
+#pragma pop_macro("fread")
+#pragma pop_macro("fopen")
@@ -0,0 +1,13 @@
+#pragma once
+
+/**
+ * @brief Host stand-in for the Arduino SPI library: there is no bus on the
+ * desktop, so nothing needs to be done
+ */
+class SPIClass {
+public:
+  void begin() {}
+  void end() {}
+};
+
+inline SPIClass SPI;
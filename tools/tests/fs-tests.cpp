@@ -0,0 +1,265 @@
+/**
+ * @brief Regression tests of the posix API with the FileSystemMemory and the
+ * FileSystemSD on the host stand-in of the SD library: the failed checks are
+ * printed and the exit code is 1 if any check failed.
+ *
+ *   fs-tests
+ */
+#include <errno.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FileSystems.h"
+#include "FileSystems/FileSystemSD.h"
+#include "LoggerFSDeferred.h"
+
+using namespace file_systems;
+
+static int failures = 0;
+static FileSystemMemory *fsm = nullptr;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+// creates a writable file with the indicated content
+static void createFile(const char *path, const char *data) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+  CHECK(fd >= 0);
+  write(fd, data, strlen(data));
+  close(fd);
+}
+
+// removing the next entry of an open directory must not affect readdir
+static void testUnlinkWhileReaddir() {
+  createFile("/mem/tmp/a.txt", "a");
+  createFile("/mem/tmp/b.txt", "b");
+  createFile("/mem/tmp/c.txt", "c");
+  DIR *dir = opendir("/mem/tmp");
+  CHECK(dir != nullptr);
+  dirent *p_entry = readdir(dir);
+  CHECK(p_entry != nullptr && strcmp(p_entry->d_name, "a.txt") == 0);
+  CHECK(unlink("/mem/tmp/b.txt") == 0);
+  p_entry = readdir(dir);
+  CHECK(p_entry != nullptr && strcmp(p_entry->d_name, "c.txt") == 0);
+  CHECK(readdir(dir) == nullptr);
+  // the last entry is removed while the directory is at the end
+  rewinddir(dir);
+  readdir(dir);
+  CHECK(unlink("/mem/tmp/c.txt") == 0);
+  CHECK(readdir(dir) == nullptr);
+  closedir(dir);
+  CHECK(unlink("/mem/tmp/a.txt") == 0);
+}
+
+// fseek must use the position which was determined by the file system
+static void testFseek() {
+  static const char data[] = "abcdefghijklmnopqrst";
+  CHECK(fsm->add("/mem/seek.txt", data, 20));
+  char buffer[21] = {0};
+  FILE *fp = fopen("/mem/seek.txt", "r");
+  CHECK(fp != nullptr);
+  CHECK(fseek(fp, -5, SEEK_END) == 0);
+  CHECK(fread(buffer, 1, 5, fp) == 5 && memcmp(buffer, "pqrst", 5) == 0);
+  // within the buffer which was filled after SEEK_END
+  CHECK(fseek(fp, -2, SEEK_CUR) == 0);
+  CHECK(fread(buffer, 1, 2, fp) == 2 && memcmp(buffer, "st", 2) == 0);
+  // read only files end at their size
+  CHECK(fseek(fp, 200, SEEK_SET) == 0);
+  CHECK(fseek(fp, -10, SEEK_CUR) == 0);
+  CHECK(fread(buffer, 1, 3, fp) == 3 && memcmp(buffer, "klm", 3) == 0);
+  CHECK(fseek(fp, 195, SEEK_SET) == 0);
+  CHECK(fread(buffer, 1, 3, fp) == 0);
+  CHECK(fseek(fp, 0, SEEK_SET) == 0);
+  CHECK(fread(buffer, 1, 20, fp) == 20 && memcmp(buffer, data, 20) == 0);
+  fclose(fp);
+}
+
+// writing after a seek past the end of a RAM file creates a gap with 0
+static void testSeekGap() {
+  int fd = open("/mem/gap.bin", O_RDWR | O_CREAT | O_TRUNC);
+  CHECK(fd >= 0);
+  CHECK(write(fd, "ab", 2) == 2);
+  CHECK(lseek(fd, 10, SEEK_SET) == 10);
+  CHECK(write(fd, "cd", 2) == 2);
+  CHECK(lseek(fd, 20, SEEK_END) == 32);
+  struct stat st;
+  CHECK(fstat(fd, &st) == 0 && st.st_size == 12);
+  char buffer[20];
+  CHECK(read(fd, buffer, sizeof(buffer)) == 0);
+  CHECK(lseek(fd, 0, SEEK_SET) == 0);
+  CHECK(read(fd, buffer, sizeof(buffer)) == 12);
+  CHECK(memcmp(buffer, "ab\0\0\0\0\0\0\0\0cd", 12) == 0);
+  close(fd);
+  CHECK(unlink("/mem/gap.bin") == 0);
+}
+
+// a file name with a trailing / is not valid
+static void testStatTrailingSlash() {
+  static const char data[] = "data";
+  CHECK(fsm->add("/mem/stat/a.txt", data, 4));
+  struct stat st;
+  CHECK(stat("/mem/stat/a.txt", &st) == 0 && S_ISREG(st.st_mode));
+  errno = 0;
+  CHECK(stat("/mem/stat/a.txt/", &st) == -1 && errno == ENOTDIR);
+  CHECK(stat("/mem/stat/", &st) == 0 && S_ISDIR(st.st_mode));
+  errno = 0;
+  CHECK(stat("/mem/stat/b.txt", &st) == -1 && errno == ENOENT);
+}
+
+// reads the same files from several threads while another thread creates,
+// removes and adds files (which grows the index and the fd table) and a
+// third one opens the files which are removed
+static void testThreads() {
+  static const char data[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+  const int files = 50;
+  for (int j = 0; j < files; j++) {
+    CHECK(fsm->add(("/mem/mt/f" + std::to_string(j)).c_str(), data, 36));
+  }
+  std::atomic<int> errors{0};
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&, t]() {
+      char buffer[40];
+      for (int j = 0; j < 2000; j++) {
+        std::string path = "/mem/mt/f" + std::to_string((j + t) % files);
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+          errors++;
+          continue;
+        }
+        int offset = j % 30;
+        if (lseek(fd, offset, SEEK_SET) != offset ||
+            read(fd, buffer, 6) != 6 ||
+            memcmp(buffer, data + offset, 6) != 0) {
+          errors++;
+        }
+        close(fd);
+      }
+    });
+  }
+  std::thread writer([&]() {
+    struct stat st;
+    for (int j = 0; !stop; j++) {
+      std::string path = "/mem/mt/w" + std::to_string(j % 8);
+      int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
+      if (fd < 0 || write(fd, data, 10) != 10) errors++;
+      close(fd);
+      if (stat(path.c_str(), &st) != 0 || st.st_size != 10) errors++;
+      if (unlink(path.c_str()) != 0) errors++;
+      std::string added = "/mem/mt/a" + std::to_string(j);
+      if (j < 2000 && !fsm->add(added.c_str(), data, 36)) errors++;
+    }
+  });
+  // opens the files of the writer while they are unlinked: open may fail
+  std::thread opener([&]() {
+    char buffer[10];
+    for (int j = 0; !stop; j++) {
+      std::string path = "/mem/mt/w" + std::to_string(j % 8);
+      int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) continue;
+      read(fd, buffer, sizeof(buffer));
+      close(fd);
+    }
+  });
+  for (auto &reader : readers) reader.join();
+  stop = true;
+  writer.join();
+  opener.join();
+  CHECK(errors == 0);
+}
+
+// a truncating open must drop the cached blocks of the other open fds
+static void testSDTruncate() {
+  // file systems stay registered: they must not be destroyed
+  static FileSystemSD sd("/sd", SD);
+  sd.setCacheSize(4, 512);
+  File file = SD.open("/trunc.txt", FILE_WRITE);
+  file.write((const uint8_t *)"old-data", 8);
+  file.close();
+  int fd = open("/sd/trunc.txt", O_RDONLY);
+  CHECK(fd >= 0);
+  char buffer[8];
+  CHECK(read(fd, buffer, 8) == 8 && memcmp(buffer, "old-data", 8) == 0);
+  // change the content behind the cache, as a truncating open on the card
+  file = SD.open("/trunc.txt", FILE_READ | SD_HOST_MODE_WRITE);
+  file.write((const uint8_t *)"new-data", 8);
+  file.close();
+  int fd_trunc = open("/sd/trunc.txt", O_WRONLY | O_TRUNC);
+  CHECK(fd_trunc >= 0);
+  CHECK(lseek(fd, 0, SEEK_SET) == 0);
+  CHECK(read(fd, buffer, 8) == 8 && memcmp(buffer, "new-data", 8) == 0);
+  close(fd_trunc);
+  close(fd);
+  SD.remove("/trunc.txt");
+}
+
+static bool addLog(FSLogBuffer &buffer, const char *fmt, ...) {
+  va_list arg;
+  va_start(arg, fmt);
+  bool result = buffer.add(0, 0, fmt, arg);
+  va_end(arg);
+  return result;
+}
+
+// the capacity of the deferred log buffer is rounded up to a power of 2
+static void testLogBufferSize() {
+  FSLogBuffer empty(0);
+  CHECK(!empty);
+  FSLogBuffer buffer(100);
+  CHECK(buffer);
+  int added = 0;
+  while (added < 200 && addLog(buffer, "msg %d", added)) added++;
+  CHECK(added == 128);
+  char text[40];
+  uint8_t level;
+  uint32_t timestamp;
+  for (int j = 0; j < added; j++) {
+    char expected[40];
+    snprintf(expected, sizeof(expected), "msg %d", j);
+    CHECK(buffer.format(text, sizeof(text), level, timestamp));
+    CHECK(strcmp(text, expected) == 0);
+  }
+  CHECK(!buffer.format(text, sizeof(text), level, timestamp));
+  CHECK(buffer.dropped() == 1);
+}
+
+// nested mount prefixes only match complete path components
+static void testNestedMounts() {
+  static FileSystemMemory outer("/nest");
+  static FileSystemMemory inner("/nest/cache");
+  Registry &registry = Registry::DefaultRegistry();
+  CHECK(&registry.fileSystem("/nest/cache") == &inner);
+  CHECK(&registry.fileSystem("/nest/cache/") == &inner);
+  CHECK(&registry.fileSystem("/nest/cache/a.txt") == &inner);
+  CHECK(&registry.fileSystem("/nest/cachefoo/a.txt") == &outer);
+  CHECK(&registry.fileSystem("/nest/cache.txt") == &outer);
+  CHECK(&registry.fileSystem("/nest") == &outer);
+  CHECK(&registry.fileSystem("/nested") != &outer);
+}
+
+int main() {
+  FileSystemMemory fs("/mem");
+  fsm = &fs;
+  testUnlinkWhileReaddir();
+  testFseek();
+  testStatTrailingSlash();
+  testSeekGap();
+  testThreads();
+  testSDTruncate();
+  testLogBufferSize();
+  testNestedMounts();
+  if (failures > 0) {
+    fprintf(stderr, "fs-tests: %d checks failed\n", failures);
+    return 1;
+  }
+  printf("fs-tests: ok\n");
+  return 0;
+}